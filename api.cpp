@@ -1,7 +1,30 @@
 #include "api.h"
+#include "credits.h"
 
+#include <thread>
 
-api::api(const string& key) : api_key(key), base_url("https://api.themoviedb.org/3") {
+//rough memory use of parsed results, used for the memory cache budget
+static size_t castBytes(const vector<Actor>& cast) {
+    size_t bytes = cast.capacity() * sizeof(Actor);
+    for(const auto& actor : cast) {
+        bytes += actor.name.capacity() + actor.profile_path.capacity();
+    }
+    return bytes;
+}
+
+static size_t filmographyBytes(const vector<Movie>& movies) {
+    size_t bytes = movies.capacity() * sizeof(Movie);
+    for(const auto& movie : movies) {
+        bytes += movie.title.capacity() + movie.release_date.capacity() + movie.poster_path.capacity();
+    }
+    return bytes;
+}
+
+api::api(const string& key, const string& baseUrl)
+    : api_key(key), base_url(baseUrl), maxRetries(3), negativeTtl(6 * 60 * 60),
+      castCache(48 * 1024 * 1024, castBytes), filmographyCache(16 * 1024 * 1024, filmographyBytes),
+      networkRequests(0), networkMicros(0), diskHits(0), diskMicros(0), throttledCount(0), retryCount(0), knownMissingCount(0),
+      wireByteCount(0), decodedByteCount(0), revalidatedCount(0), castDroppedCount(0) {
     apiLog.open("apiLog.txt");
     if (!apiLog.is_open()) {
         apiLog << "ERROR: Error opening api log file" << endl;
@@ -14,36 +37,325 @@ api::~api() {
     }
 }
 
-string api::fetchData(const string &url) {
+void api::enableDiskCache(const string &directory, size_t maxBytes) {
+    responseCache = make_unique<diskCache>(directory, maxBytes);
+    responseCache->setMissingTtl(negativeTtl);
+}
 
-    //getting command for fetching data
-    string tempFile = "temp.json";
-    string command = "curl -s \"" + url + "\" > " + tempFile;
+void api::setRateLimit(double requestsPerSecond, int burst) {
+    limiter.setRate(requestsPerSecond, burst);
+}
 
-    //TODO: delete later. this is for debugging only
-    apiLog << "Executing API request: " << url << endl;
+void api::setMaxConcurrency(int limit) {
+    limiter.setMaxConcurrency(limit);
+}
+
+void api::enableHedging(double budget) {
+    hedging = make_unique<hedgePolicy>(budget);
+}
+
+void api::setCastPolicy(const castPolicy &castDepth) {
+    policy = castDepth;
+
+    //parsed results were filtered with the old policy (the disk cache keeps whole responses, so it stays valid)
+    castCache.clear();
+    filmographyCache.clear();
+}
+
+void api::setMemoryCacheBudget(size_t maxBytes) {
+    castCache.setMaxBytes(maxBytes / 4 * 3);
+    filmographyCache.setMaxBytes(maxBytes / 4);
+}
+
+void api::recordTo(const string &directory) {
+    recorder = make_unique<fixtureStore>(directory);
+}
+
+void api::replayFrom(const string &directory, int latencyMs) {
+    replayer = make_unique<fixtureStore>(directory, latencyMs);
+}
+
+apiStats api::getStats() const {
+    apiStats stats;
+    stats.networkRequests = networkRequests;
+    stats.networkMs = networkMicros / 1000.0;
+    stats.diskHits = diskHits;
+    stats.diskMs = diskMicros / 1000.0;
+    stats.memoryHits = castCache.hitCount() + filmographyCache.hitCount();
+    stats.memoryMisses = castCache.missCount() + filmographyCache.missCount();
+    stats.coalesced = castFlights.coalescedCount() + filmographyFlights.coalescedCount() +
+                      asyncCastFlights.coalescedCount() + asyncFilmographyFlights.coalescedCount() +
+                      asyncRequestFlights.coalescedCount();
+    stats.knownMissing = knownMissingCount;
+    stats.throttled = throttledCount;
+    stats.retries = retryCount;
+    stats.concurrency = limiter.currentConcurrency();
+    stats.wireBytes = wireByteCount;
+    stats.decodedBytes = decodedByteCount;
+    stats.revalidated = revalidatedCount;
+    if(hedging) {
+        stats.hedged = hedging->hedgeCount();
+        stats.hedgeWins = hedging->winCount();
+    }
+    stats.castDropped = castDroppedCount;
+    if(responseCache) {
+        stats.diskBytesRead = responseCache->bytesRead();
+        stats.diskBytesWritten = responseCache->bytesWritten();
+    }
+    return stats;
+}
+
+void api::setNegativeTtl(long long seconds) {
+    negativeTtl = seconds;
+    missing.setTtl(seconds);
+    if(responseCache) {
+        responseCache->setMissingTtl(seconds);
+    }
+}
+
+void api::rememberMissing(const string &key) {
+    missing.add(key);
+    if(responseCache) {
+        responseCache->putMissing(key);
+    }
+}
+
+string api::cacheKey(const string &url) const {
+    string request = url.rfind(base_url, 0) == 0 ? url.substr(base_url.size()) : url;
+    return diskCache::normalizeKey(request);
+}
+
+bool api::lookupCached(const string &key, string &body, staleEntry &stale) {
+    //lookups known to have no result cost nothing
+    if(missing.contains(key)) {
+        knownMissingCount++;
+        body.clear();
+        return true;
+    }
+
+    //check the disk cache first
+    if(responseCache) {
+        auto start = chrono::steady_clock::now();
+        bool isMissing = false;
+        bool isStale = false;
+        diskCache::validators check;
+        bool hit = responseCache->lookup(key, body, isMissing, isStale, check);
+        auto end = chrono::steady_clock::now();
+
+        //expired, but the server can tell us if it changed -> keep it for a conditional request
+        if(hit && isStale) {
+            stale.body = move(body);
+            stale.check = check;
+            body.clear();
+            return false;
+        }
+
+        if(hit) {
+            diskHits++;
+            diskMicros += chrono::duration_cast<chrono::microseconds>(end - start).count();
+            if(isMissing) {
+                missing.add(key);
+                knownMissingCount++;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+vector<string> api::conditionalHeaders(const staleEntry &stale) {
+    vector<string> headers;
+    if(!stale.check.etag.empty()) {
+        headers.push_back("If-None-Match: " + stale.check.etag);
+    }
+    if(!stale.check.lastModified.empty()) {
+        headers.push_back("If-Modified-Since: " + stale.check.lastModified);
+    }
+    return headers;
+}
+
+bool api::shouldRetry(const string &url, const httpResponse &response, rateLimiter::clock::time_point permit, int attempt,
+                      chrono::milliseconds &backoff) {
+    double retryAfter = 0;
+    if(response.status == 429) {
+        throttledCount++;
+        auto header = response.headers.find("retry-after");
+        retryAfter = parseRetryAfter(header != response.headers.end() ? header->second : "", 1.0);
+    }
+    limiter.release(permit, response.status, retryAfter);
 
-    //executing command
-    int result = system(command.c_str());
-    if(result != 0 ) {
-        apiLog << "ERROR: Failed to execute command: " << command << endl;
-        apiLog << "ERROR: Error code: " << result << endl;
+    bool retryable = !response.error.empty() || response.status == 429 || response.status >= 500;
+    if(!retryable || attempt >= maxRetries) {
+        return false;
+    }
+
+    retryCount++;
+    log() << "Retrying API request (attempt " << attempt + 2 << ", status " << response.status << "): " << url << endl;
+
+    //a 429 already pauses the limiter for Retry-After, other failures back off exponentially
+    backoff = response.status == 429 ? chrono::milliseconds(0) : chrono::milliseconds(250 << attempt);
+    return true;
+}
+
+chrono::milliseconds api::hedgeDelay() const {
+    return hedging ? hedging->delay() : chrono::milliseconds::zero();
+}
+
+function<bool()> api::hedgeCheck() {
+    if(!hedging) {
+        return nullptr;
+    }
+    return [this]() { return hedging->tryHedge(); };
+}
+
+void api::recordLatency(const httpResponse &response, chrono::steady_clock::time_point sent) {
+    if(!hedging || !response.error.empty()) {
+        return;
+    }
+    hedging->record(chrono::duration<double, milli>(chrono::steady_clock::now() - sent).count());
+    if(response.hedgeWon) {
+        hedging->countWin();
+    }
+}
+
+string api::finishRequest(const string &url, const string &key, httpResponse &response, chrono::steady_clock::time_point start,
+                          staleEntry &stale) {
+    auto end = chrono::steady_clock::now();
+
+    networkRequests++;
+    networkMicros += chrono::duration_cast<chrono::microseconds>(end - start).count();
+    wireByteCount += response.wireBytes;
+    decodedByteCount += response.body.size();
+
+    if(recorder) {
+        recorder->record(key, response, chrono::duration<double, milli>(end - start).count());
+    }
+
+    if(!response.error.empty()) {
+        log() << "ERROR: Failed to execute request: " << url << endl;
+        log() << "ERROR: " << response.error << endl;
+        return "";
+    }
+
+    //not modified -> the expired entry is still current, it just gets a new time stored (no body was sent)
+    if(response.status == 304 && !stale.check.empty()) {
+        revalidatedCount++;
+        if(responseCache) {
+            responseCache->refresh(key);
+        }
+        return move(stale.body);
+    }
+
+    //the id or path doesn't exist -> remember that, so it isn't asked for again
+    if(response.status == 404) {
+        log() << "ERROR: Request returned HTTP status 404: " << url << endl;
+        rememberMissing(key);
         return "";
     }
 
-    //read file and add to return string
-    ifstream file(tempFile);
-    if(!file.is_open()) {
-        apiLog << "ERROR: Failed to open temporary file: " << tempFile << endl;
+    //error bodies (401, 429 after the last retry, ...) are not api data
+    if(response.status != 200) {
+        log() << "ERROR: Request returned HTTP status " << response.status << ": " << url << endl;
         return "";
     }
-    string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
-    file.close();
 
-    //remove the temporary file
-    remove(tempFile.c_str());
+    //only successful responses are worth keeping (with their validators, for revalidation once they expire)
+    if(responseCache) {
+        diskCache::validators check;
+        auto etag = response.headers.find("etag");
+        auto lastModified = response.headers.find("last-modified");
+        check.etag = etag != response.headers.end() ? etag->second : "";
+        check.lastModified = lastModified != response.headers.end() ? lastModified->second : "";
+        responseCache->put(key, response.body, check);
+    }
+
+    return move(response.body);
+}
+
+string api::fetchData(const string &url) {
+
+    string key = cacheKey(url);
+
+    string cached;
+    staleEntry stale;
+    if(lookupCached(key, cached, stale)) {
+        return cached;
+    }
+    vector<string> headers = conditionalHeaders(stale);
+
+    //TODO: delete later. this is for debugging only
+    log() << "Executing API request: " << url << endl;
+
+    //request goes through the pooled client, so there is no shell, no curl process and no temp file
+    //(or to the saved fixtures when replaying)
+    auto start = chrono::steady_clock::now();
+    httpResponse response;
+    for(int attempt = 0; ; attempt++) {
+        if(replayer) {
+            response = replayer->replay(key);
+            break;
+        }
+
+        //the limiter decides when the request may go out
+        auto permit = limiter.acquire();
+        auto sent = chrono::steady_clock::now();
+        response = http.get(url, headers, hedgeDelay(), hedgeCheck());
+        recordLatency(response, sent);
+
+        chrono::milliseconds backoff(0);
+        if(!shouldRetry(url, response, permit, attempt, backoff)) {
+            break;
+        }
+        this_thread::sleep_for(backoff);
+    }
+
+    return finishRequest(url, key, response, start, stale);
+}
+
+task<string> api::fetchDataAsync(eventLoop &loop, string url) {
+    //the loop would also share one transfer between identical urls, but every waiter would still take a limiter
+    //permit and count, cache and record the response -> identical requests are coalesced here instead
+    string key = cacheKey(url);
+    co_return co_await asyncRequestFlights.run(loop, key, requestAsync(loop, url, key));
+}
+
+task<string> api::requestAsync(eventLoop &loop, string url, string key) {
+    string cached;
+    staleEntry stale;
+    if(lookupCached(key, cached, stale)) {
+        co_return cached;
+    }
+    vector<string> headers = conditionalHeaders(stale);
+
+    log() << "Executing API request: " << url << endl;
+
+    //same steps as fetchData, but every wait suspends this coroutine instead of blocking the thread
+    auto start = chrono::steady_clock::now();
+    httpResponse response;
+    for(int attempt = 0; ; attempt++) {
+        if(replayer) {
+            co_await loop.sleep(chrono::milliseconds(replayer->latency()));
+            response = replayer->load(key);
+            break;
+        }
+
+        rateLimiter::clock::time_point permit;
+        rateLimiter::clock::duration wait;
+        while(!limiter.tryAcquire(permit, wait)) {
+            co_await loop.sleep(wait);
+        }
+        auto sent = chrono::steady_clock::now();
+        response = co_await loop.fetch(url, headers, hedgeDelay(), hedgeCheck());
+        recordLatency(response, sent);
+
+        chrono::milliseconds backoff(0);
+        if(!shouldRetry(url, response, permit, attempt, backoff)) {
+            break;
+        }
+        co_await loop.sleep(backoff);
+    }
 
-    return content;
+    co_return finishRequest(url, key, response, start, stale);
 }
 
 string api::urlEncode(const string& str){
@@ -70,8 +382,10 @@ int api::searchActor(const string &name) {
                 return result["id"].get<int>();
             }
         }
+        //valid answer without a match -> nobody by that name
+        rememberMissing(cacheKey(url));
     }
-    apiLog << "ERROR: Actor " << name << " was not found in database." << endl;
+    log() << "ERROR: Actor " << name << " was not found in database." << endl;
     return 0;
 }
 
@@ -95,12 +409,54 @@ Actor* api::getActor(int actorID) {
             return new Actor(id, name, profile_path);
         }
     } catch (const exception& e) {
-        apiLog << "ERROR: Error parsing JSON: " << e.what() << endl;
+        log() << "ERROR: Error parsing JSON: " << e.what() << endl;
     }
 
     return nullptr;
 }
 
+Actor* api::resolveActor(const string &name) {
+    string encodedName = urlEncode(name);
+    string url = base_url + "/search/person?api_key=" + api_key + "&query=" + encodedName;
+    return actorFromSearch(name, url, fetchData(url));
+}
+
+task<Actor*> api::resolveActorAsync(eventLoop &loop, string name) {
+    string encodedName = urlEncode(name);
+    string url = base_url + "/search/person?api_key=" + api_key + "&query=" + encodedName;
+    string response = co_await fetchDataAsync(loop, url);
+    co_return actorFromSearch(name, url, response);
+}
+
+Actor* api::actorFromSearch(const string &name, const string &url, const string &response) {
+    if(response.empty()) {
+        log() << "ERROR: Actor " << name << " was not found in database." << endl;
+        return nullptr;
+    }
+
+    try {
+        json data = json::parse(response);
+        if (data.contains("results") && data["results"].is_array() && !data["results"].empty()) {
+            //the search result already has id, name and profile_path -> no /person request needed
+            const auto& result = data["results"][0];
+            if (result.contains("id") && result.contains("name")) {
+                int id = result["id"].get<int>();
+                string actorName = result["name"].get<string>();
+                string profile_path = result.contains("profile_path") && !result["profile_path"].is_null() ?
+                                      result["profile_path"].get<string>() : "";
+                return new Actor(id, actorName, profile_path);
+            }
+        }
+        //valid answer without a match -> nobody by that name
+        rememberMissing(cacheKey(url));
+    } catch (const exception& e) {
+        log() << "ERROR: Error parsing JSON: " << e.what() << endl;
+    }
+
+    log() << "ERROR: Actor " << name << " was not found in database." << endl;
+    return nullptr;
+}
+
 vector<Actor> api::getActors(const string &movieName) {
     vector<Actor> actors;
 
@@ -109,7 +465,7 @@ vector<Actor> api::getActors(const string &movieName) {
 
     string response = fetchData(url);
     if(response.empty()) {
-        apiLog << "ERROR: Failed to fetch actors for movie: " << movieName << endl;
+        log() << "ERROR: Failed to fetch actors for movie: " << movieName << endl;
         return actors;
     }
 
@@ -117,73 +473,180 @@ vector<Actor> api::getActors(const string &movieName) {
         json movieData = json::parse(response);
         if(!movieData["results"].empty()) {
             int movieID = movieData["results"][0]["id"].get<int>();
-
-            stringstream creditsURL;
-            creditsURL << base_url << "/movie/" << movieID << "/credits?api_key=" << api_key;
-            string creditResponse = fetchData(creditsURL.str());
-
-            if(creditResponse.empty()) {
-                apiLog << "ERROR: Failed to fetch credits for movie: " << movieName << endl;
-                return actors;
-            }
-
-            json creditData = json::parse(creditResponse);
-            if(creditData.contains("cast")) {
-                for(const auto& actor : creditData["cast"]) {
-                    int id = actor.value("id", 0);
-                    string name = actor.value("name", "Unknown name");
-                    string profile_path = actor.contains("profile_path") && !actor["profile_path"].is_null() ? actor["profile_path"].get<string>() : "";
-
-                    actors.emplace_back(id, name, profile_path);
-                }
-            }
+            return getCastByMovieId(movieID);
         } else {
-            apiLog << "ERROR: Movie " <<  movieName << " not found." << endl;
+            log() << "ERROR: Movie " <<  movieName << " not found." << endl;
+            rememberMissing(cacheKey(url));
         }
     } catch (const exception& e) {
-        apiLog << "ERROR: Error parsing JSON: " << e.what() << endl;
+        log() << "ERROR: Error parsing JSON: " << e.what() << endl;
     }
     return actors;
 }
 
+vector<Actor> api::getCastByMovieId(int movieID) {
+    //co-stars share movies, so the same cast is often asked for again
+    if(auto cached = castCache.get(movieID)) {
+        return *cached;
+    }
+
+    //if another thread is already fetching this movie, wait for its result instead of requesting it again
+    return *castFlights.run(movieID, [&]() { return fetchCast(movieID); });
+}
+
+shared_ptr<const vector<Actor>> api::fetchCast(int movieID) {
+    //the previous fetch may have finished between the cache check and the start of this one
+    if(auto cached = castCache.peek(movieID)) {
+        return cached;
+    }
+
+    stringstream creditsURL;
+    creditsURL << base_url << "/movie/" << movieID << "/credits?api_key=" << api_key;
+    return castFromResponse(movieID, creditsURL.str(), fetchData(creditsURL.str()));
+}
+
+task<vector<Actor>> api::getCastByMovieIdAsync(eventLoop &loop, int movieID) {
+    if(auto cached = castCache.get(movieID)) {
+        co_return *cached;
+    }
+
+    //coroutines asking for a movie that is already being fetched on this loop wait for that fetch
+    //(sharing only the transfer would still count, record and cache the response once per coroutine)
+    co_return *co_await asyncCastFlights.run(loop, movieID, fetchCastAsync(loop, movieID));
+}
+
+task<shared_ptr<const vector<Actor>>> api::fetchCastAsync(eventLoop &loop, int movieID) {
+    if(auto cached = castCache.peek(movieID)) {
+        co_return cached;
+    }
+
+    stringstream creditsURL;
+    creditsURL << base_url << "/movie/" << movieID << "/credits?api_key=" << api_key;
+    string creditResponse = co_await fetchDataAsync(loop, creditsURL.str());
+    co_return castFromResponse(movieID, creditsURL.str(), creditResponse);
+}
+
+shared_ptr<const vector<Actor>> api::castFromResponse(int movieID, const string &url, const string &response) {
+    vector<Actor> actors;
+
+    if(response.empty()) {
+        log() << "ERROR: Failed to fetch credits for movie ID: " << movieID << endl;
+        return make_shared<const vector<Actor>>();
+    }
+
+    //streaming parse: only the cast fields we use are copied, crew is skipped
+    string error;
+    size_t dropped = 0;
+    if(!parseCast(response, actors, error, policy, &dropped)) {
+        log() << "ERROR: Error parsing JSON: " << error << endl;
+        return make_shared<const vector<Actor>>();
+    }
+    castDroppedCount += dropped;
+
+    //only a response without any cast means the movie has none (the policy may just have filtered it)
+    if(actors.empty() && dropped == 0) {
+        rememberMissing(cacheKey(url)); //movie without cast (unreleased, documentary, ...)
+        return make_shared<const vector<Actor>>();
+    }
+    return castCache.put(movieID, move(actors));
+}
+
 vector<Movie> api::getMovies(const string &actorName) {
     vector<Movie > movies;
 
     int actorID = searchActor(actorName);
     if(actorID <= 0) {
-        apiLog << "ERROR: Actor " << actorName << "not found." << endl;
+        log() << "ERROR: Actor " << actorName << "not found." << endl;
         return movies;
     }
 
+    return getMoviesByActorId(actorID);
+}
+
+vector<Movie> api::getMoviesByActorId(int actorID) {
+    if(auto cached = filmographyCache.get(actorID)) {
+        return *cached;
+    }
+
+    return *filmographyFlights.run(actorID, [&]() { return fetchFilmography(actorID); });
+}
+
+shared_ptr<const vector<Movie>> api::fetchFilmography(int actorID) {
+    if(auto cached = filmographyCache.peek(actorID)) {
+        return cached;
+    }
+
+    stringstream creditURL;
+    creditURL << base_url << "/person/" << actorID << "/movie_credits?api_key=" << api_key;
+    return filmographyFromResponse(actorID, creditURL.str(), fetchData(creditURL.str()));
+}
+
+task<vector<Movie>> api::getMoviesByActorIdAsync(eventLoop &loop, int actorID) {
+    if(auto cached = filmographyCache.get(actorID)) {
+        co_return *cached;
+    }
+
+    co_return *co_await asyncFilmographyFlights.run(loop, actorID, fetchFilmographyAsync(loop, actorID));
+}
+
+task<shared_ptr<const vector<Movie>>> api::fetchFilmographyAsync(eventLoop &loop, int actorID) {
+    if(auto cached = filmographyCache.peek(actorID)) {
+        co_return cached;
+    }
+
     stringstream creditURL;
     creditURL << base_url << "/person/" << actorID << "/movie_credits?api_key=" << api_key;
+    string creditResponse = co_await fetchDataAsync(loop, creditURL.str());
+    co_return filmographyFromResponse(actorID, creditURL.str(), creditResponse);
+}
+
+shared_ptr<const vector<Movie>> api::filmographyFromResponse(int actorID, const string &url, const string &response) {
+    vector<Movie> movies;
+
+    if(response.empty()) {
+        log() << "ERROR: Failed to fetch credits for actor ID: " << actorID << endl;
+        return make_shared<const vector<Movie>>();
+    }
+
+    string error;
+    size_t dropped = 0;
+    if(!parseFilmography(response, movies, error, nullptr, policy, &dropped)) {
+        log() << "ERROR: Error parsing JSON: " << error << endl;
+        return make_shared<const vector<Movie>>();
+    }
+    castDroppedCount += dropped;
 
-    string creditResponse = fetchData(creditURL.str());
-    if(creditResponse.empty()) {
-        apiLog << "ERROR: Failed to fetch credits for actor: " << actorName << endl;
+    if(movies.empty() && dropped == 0) {
+        rememberMissing(cacheKey(url)); //person without cast credits (crew only, ...)
+        return make_shared<const vector<Movie>>();
+    }
+    return filmographyCache.put(actorID, move(movies));
+}
+
+vector<Movie> api::getMoviesByActorId(int actorID, Actor &person) {
+    vector<Movie> movies;
+
+    //append_to_response returns the person record and their movie_credits in the same response
+    stringstream personURL;
+    personURL << base_url << "/person/" << actorID << "?api_key=" << api_key << "&append_to_response=movie_credits";
+
+    string response = fetchData(personURL.str());
+    if(response.empty()) {
+        log() << "ERROR: Failed to fetch person and credits for actor ID: " << actorID << endl;
         return movies;
     }
 
-    try {
-        json creditData = json::parse(creditResponse);
-        if(creditData.contains("cast")) {
-            for(const auto& movie : creditData["cast"]) {
-                int id = movie.value("id", 0);
-                string title = movie.value("title", "Unknown title");
-                string date = (movie.contains("release_date") &&
-               !movie["release_date"].is_null() &&
-               !movie["release_date"].get<string>().empty())
-              ? movie["release_date"].get<string>()
-              : "No release date";
-                string poster_path = movie.contains("poster_path") && !movie["poster_path"].is_null() ? movie["poster_path"].get<string>() : "";
-
-                movies.emplace_back(id, title, date, poster_path);
-            }
-        }
-    } catch (const exception& e) {
-        apiLog << "ERROR: Error parsing JSON: " << e.what() << endl;
+    string error;
+    size_t dropped = 0;
+    if(!parseFilmography(response, movies, error, &person, policy, &dropped)) {
+        log() << "ERROR: Error parsing JSON: " << error << endl;
+        return movies;
     }
+    castDroppedCount += dropped;
 
+    if(!movies.empty()) {
+        filmographyCache.put(actorID, movies);
+    }
     return movies;
 }
 
@@ -6,8 +6,19 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <syncstream>
+#include <memory>
+#include <atomic>
+#include <chrono>
 
 #include "json.hpp"
+#include "http.h"
+#include "cache.h"
+#include "replay.h"
+#include "limiter.h"
+#include "hedge.h"
+#include "singleflight.h"
+#include "async.h"
 using json = nlohmann::json;
 using namespace std;
 
@@ -19,7 +30,7 @@ struct Movie {
     string poster_path;
 
     Movie(int id, string title, string release_date, string poster_path)
-        : id(id), title(title), release_date(release_date), poster_path(poster_path) {}
+        : id(id), title(move(title)), release_date(move(release_date)), poster_path(move(poster_path)) {}
 };
 
 //actor object to store actor information including id (for url), name, and profile path (for image url)
@@ -30,21 +41,185 @@ struct Actor {
 
     Actor() : id(0) {}
     Actor(int id, string name, string profile_path = "")
-        : id(id), name(name), profile_path(profile_path) {}
+        : id(id), name(move(name)), profile_path(move(profile_path)) {}
+};
+
+//which cast entries are kept while parsing credits (everything by default)
+//big ensemble casts connect an actor to hundreds of extras, which blows up the graph and the next expansion
+struct castPolicy {
+    int depth; //keep the first depth billed entries, TMDB's "order" field is 0..depth-1 (-1 -> no limit)
+    bool skipUncredited; //drop roles marked "(uncredited)"
+    bool skipVoice; //drop roles marked "(voice)"
+
+    castPolicy(int depth = -1, bool skipUncredited = false, bool skipVoice = false)
+        : depth(depth), skipUncredited(skipUncredited), skipVoice(skipVoice) {}
+
+    bool keeps(int order, bool uncredited, bool voice) const {
+        if (depth >= 0 && order >= depth) {
+            return false;
+        }
+        return !(skipUncredited && uncredited) && !(skipVoice && voice);
+    }
+};
+
+//counters for where api data came from
+struct apiStats {
+    long long networkRequests; //requests that went over the network (cold), or to the fixtures when replaying
+    double networkMs; //total time spent in those requests
+    long long diskHits; //requests answered by the on-disk cache (warm)
+    double diskMs; //total time spent reading those entries
+    long long memoryHits; //casts/filmographies answered by the in-memory cache (no request, no parsing)
+    long long memoryMisses;
+    long long coalesced; //lookups and async requests that waited for an identical one already in flight
+    long long knownMissing; //lookups answered by the negative cache (known to have no result)
+    long long throttled; //responses with status 429 (too many requests)
+    long long retries; //requests sent again after a 429, a 5xx or a failed transfer
+    int concurrency; //requests the rate limiter currently allows in flight
+    long long wireBytes; //response bodies as received over the network (compressed)
+    long long decodedBytes; //the same bodies after decoding
+    long long diskBytesRead; //cache entries read from disk (compressed)
+    long long diskBytesWritten; //cache entries written to disk (compressed)
+    long long revalidated; //expired entries the server confirmed unchanged (304, headers only)
+    long long hedged; //duplicate requests sent because the original was slower than the usual p95
+    long long hedgeWins; //hedged requests where the duplicate answered first
+    long long castDropped; //cast entries left out by the cast policy while parsing
+
+    apiStats() : networkRequests(0), networkMs(0), diskHits(0), diskMs(0), memoryHits(0), memoryMisses(0),
+                 coalesced(0), knownMissing(0), throttled(0), retries(0), concurrency(0),
+                 wireBytes(0), decodedBytes(0), diskBytesRead(0), diskBytesWritten(0), revalidated(0),
+                 hedged(0), hedgeWins(0), castDropped(0) {}
 };
 
 class api {
 private:
     string api_key;
     string base_url;
+    httpClient http; //keeps connections open between requests
+    rateLimiter limiter; //token bucket + adaptive concurrency in front of the network
+    int maxRetries; //how many times a request is sent again after a 429, a 5xx or a failed transfer
+    long long negativeTtl; //seconds a "known missing" lookup is remembered (memory and disk)
+    unique_ptr<diskCache> responseCache; //persistent cache of raw responses (null when disabled)
+    unique_ptr<fixtureStore> recorder; //saves every network request and response (null when not recording)
+    unique_ptr<fixtureStore> replayer; //answers requests from saved fixtures instead of the network (null when live)
+    unique_ptr<hedgePolicy> hedging; //when to send a duplicate of a slow request (null when hedging is off)
+    castPolicy policy; //which cast entries parsing keeps
+
+    //parsed results, checked before the disk cache and the network
+    lruCache<int, vector<Actor>> castCache; //(movie.id, cast)
+    lruCache<int, vector<Movie>> filmographyCache; //(actor.id, movies)
+
+    //lookups known to have no result (unknown names, 404s, movies without cast, ...)
+    negativeCache missing;
+
+    //lookups currently in flight, so identical concurrent lookups share one request
+    singleFlight<int, shared_ptr<const vector<Actor>>> castFlights;
+    singleFlight<int, shared_ptr<const vector<Movie>>> filmographyFlights;
+    //the same for the coroutine lookups (coroutines waiting on a thread would block their whole loop)
+    asyncSingleFlight<int, shared_ptr<const vector<Actor>>> asyncCastFlights;
+    asyncSingleFlight<int, shared_ptr<const vector<Movie>>> asyncFilmographyFlights;
+    //and for every async request: coroutines asking for a url another one on the same loop is already fetching
+    //wait for its body -> one permit, one set of counters and one cache/fixture write per request
+    asyncSingleFlight<string, string> asyncRequestFlights; //(cache key, body)
+
+    //counters behind getStats (updated from several threads)
+    atomic<long long> networkRequests;
+    atomic<long long> networkMicros;
+    atomic<long long> diskHits;
+    atomic<long long> diskMicros;
+    atomic<long long> throttledCount;
+    atomic<long long> retryCount;
+    atomic<long long> knownMissingCount;
+    atomic<long long> wireByteCount;
+    atomic<long long> decodedByteCount;
+    atomic<long long> revalidatedCount;
+    atomic<long long> castDroppedCount;
 
     ofstream apiLog;
 
+    //request + parse behind getCastByMovieId / getMoviesByActorId (results end up in the memory cache)
+    shared_ptr<const vector<Actor>> fetchCast(int movieID);
+    shared_ptr<const vector<Movie>> fetchFilmography(int actorID);
+    task<shared_ptr<const vector<Actor>>> fetchCastAsync(eventLoop& loop, int movieID);
+    task<shared_ptr<const vector<Movie>>> fetchFilmographyAsync(eventLoop& loop, int actorID);
+
+    //parsing shared by the blocking and the async lookups (url is the request the response belongs to)
+    Actor* actorFromSearch(const string& name, const string& url, const string& response);
+    shared_ptr<const vector<Actor>> castFromResponse(int movieID, const string& url, const string& response);
+    shared_ptr<const vector<Movie>> filmographyFromResponse(int actorID, const string& url, const string& response);
+
+    //expired disk cache entry kept while the server is asked whether it changed (check is empty if there is none)
+    struct staleEntry {
+        string body;
+        diskCache::validators check;
+    };
+
+    //body of fetchDataAsync, run once per cache key however many coroutines ask for it at the same time
+    task<string> requestAsync(eventLoop& loop, string url, string key);
+
+    //steps shared by fetchData and fetchDataAsync:
+    //answers a request from the negative cache or the disk cache (false if it has to be requested)
+    //an expired entry with validators is put in stale instead
+    bool lookupCached(const string& key, string& body, staleEntry& stale);
+    //If-None-Match / If-Modified-Since headers for a stale entry (none if there is no stale entry)
+    static vector<string> conditionalHeaders(const staleEntry& stale);
+    //reports a finished attempt to the limiter, returns true (and how long to back off) if it should be sent again
+    bool shouldRetry(const string& url, const httpResponse& response, rateLimiter::clock::time_point permit, int attempt,
+                     chrono::milliseconds& backoff);
+    //hedge delay and budget check handed to the http client (zero delay when hedging is off)
+    chrono::milliseconds hedgeDelay() const;
+    function<bool()> hedgeCheck();
+    //feeds the latency of a network request into the hedging policy
+    void recordLatency(const httpResponse& response, chrono::steady_clock::time_point sent);
+    //updates the counters, fixtures and disk cache, returns the body (empty if the request failed)
+    //a 304 returns the stale entry's body and marks the entry fresh again
+    string finishRequest(const string& url, const string& key, httpResponse& response, chrono::steady_clock::time_point start,
+                         staleEntry& stale);
+
+    //remembers that a request has no result, in memory and on disk
+    void rememberMissing(const string& key);
+
+    //cache key for a request url: path and parameters relative to base_url, without the api key
+    string cacheKey(const string& url) const;
+
+    //requests can come from several threads, so log lines go through a synchronized stream
+    osyncstream log() { return osyncstream(apiLog); }
+
 public:
-    api(const string& key); //constructor
+    //base url can point to a local stand-in server (e.g. "http://localhost:8080/3") for offline runs
+    api(const string& key, const string& baseUrl = "https://api.themoviedb.org/3"); //constructor
     ~api(); //destructor
 
+    //keeps responses in directory between runs (at most maxBytes), so repeated runs don't hit the network
+    void enableDiskCache(const string& directory, size_t maxBytes = 256 * 1024 * 1024);
+
+    //saves every request that goes over the network, with its response, to directory
+    void recordTo(const string& directory);
+
+    //answers every request from fixtures saved by recordTo instead of the network (nothing goes over the network)
+    //latencyMs is added to each request to simulate the real api
+    void replayFrom(const string& directory, int latencyMs = 0);
 
+    //how long lookups without a result are remembered (default 6 hours)
+    void setNegativeTtl(long long seconds);
+
+    //limits requests to requestsPerSecond on average (bursts of up to burst requests)
+    void setRateLimit(double requestsPerSecond, int burst);
+
+    //upper bound for the adaptive number of requests in flight
+    void setMaxConcurrency(int limit);
+
+    //sends a duplicate of requests slower than the recent 95th percentile, for at most budget of all requests
+    //(e.g. 0.05 -> 5%), and uses whichever answer comes first
+    void enableHedging(double budget = 0.05);
+
+    //limits which cast entries become graph edges (applies to casts and filmographies, clears the memory caches)
+    void setCastPolicy(const castPolicy& castDepth);
+
+    //sets the memory budget for parsed casts and filmographies (3/4 casts, 1/4 filmographies)
+    void setMemoryCacheBudget(size_t maxBytes);
+
+    //returns how many requests were answered by the network and by the disk cache, and how long they took
+    apiStats getStats() const;
 
     //TODO: maybe these two methods could be private?
     string fetchData(const string &url); //makes API requests
@@ -52,9 +227,23 @@ public:
 
     int searchActor(const string& name); //returns id of first actor in api search - e.g. "Tom Hanks" => 31
     Actor* getActor(int actorID); //returns pointer to actor object given their id
-
-    vector<Actor> getActors(const string& movieName);
-    vector<Movie> getMovies(const string& actorName);
+    Actor* resolveActor(const string& name); //searchActor + getActor in one request (the search result has the whole record)
+
+    vector<Actor> getActors(const string& movieName); //searches the title first -> two requests, first match only
+    vector<Actor> getCastByMovieId(int movieID); //cast of the exact movie in one request (used by graph expansion)
+    vector<Movie> getMovies(const string& actorName); //searches the name first -> two requests, first match only
+    vector<Movie> getMoviesByActorId(int actorID); //filmography of the exact person in one request (used by graph expansion)
+    vector<Movie> getMoviesByActorId(int actorID, Actor& person); //same, and also fills in the person record (still one request)
+
+    //connection pool of the requests, for the eventLoops the async lookups run on (eventLoop loop(api.client()))
+    httpClient& client() { return http; }
+
+    //coroutine versions of the lookups above, run on an eventLoop: many can be in flight on a single thread
+    //(arguments are taken by value, since the coroutine may outlive the caller's temporaries)
+    task<string> fetchDataAsync(eventLoop& loop, string url);
+    task<Actor*> resolveActorAsync(eventLoop& loop, string name);
+    task<vector<Actor>> getCastByMovieIdAsync(eventLoop& loop, int movieID);
+    task<vector<Movie>> getMoviesByActorIdAsync(eventLoop& loop, int actorID);
 };
 
 
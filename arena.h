@@ -0,0 +1,59 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+//slab allocator for records that live exactly as long as their owner (the graph's actors and movies)
+// - objects are placed into blocks of blockSize objects -> one allocation per block instead of one per object,
+//   and records added together sit next to each other in memory
+// - pointers stay valid until the arena goes away (blocks are never moved, objects are never freed one by one)
+// - everything is destroyed at once by the destructor
+template <typename T>
+class slabArena {
+private:
+    vector<T*> blocks;
+    size_t blockSize; //objects per block
+    size_t used; //objects in the last block
+    size_t count; //objects in all blocks
+
+public:
+    explicit slabArena(size_t blockSize = 1024) : blockSize(max<size_t>(1, blockSize)), used(0), count(0) {}
+
+    ~slabArena() {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            size_t objects = i + 1 == blocks.size() ? used : blockSize;
+            for (size_t j = 0; j < objects; j++) {
+                blocks[i][j].~T();
+            }
+            ::operator delete(blocks[i]);
+        }
+    }
+
+    slabArena(const slabArena&) = delete;
+    slabArena& operator=(const slabArena&) = delete;
+
+    //constructs a T in the arena (arguments are forwarded, so strings can be moved in)
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (blocks.empty() || used == blockSize) {
+            blocks.push_back(static_cast<T*>(::operator new(sizeof(T) * blockSize)));
+            used = 0;
+        }
+        T* object = new (blocks.back() + used) T(forward<Args>(args)...);
+        used++;
+        count++;
+        return object;
+    }
+
+    size_t size() const { return count; }
+
+    //allocations the arena made (one per block)
+    size_t blockCount() const { return blocks.size(); }
+};
+
+#endif //ARENA_H
@@ -0,0 +1,186 @@
+#include "async.h"
+
+#include <thread>
+#include <algorithm>
+
+eventLoop::eventLoop(httpClient& client) : http(client) {
+    multi = curl_multi_init();
+}
+
+eventLoop::eventLoop() : ownClient(make_unique<httpClient>()), http(*ownClient) {
+    multi = curl_multi_init();
+}
+
+eventLoop::~eventLoop() {
+    //transfers still running belong to coroutines that will never be resumed
+    for (auto& pair : inFlight) {
+        pair.second->request.reset(); //stops the legs, connections go back to the pool
+        curl_slist_free_all(pair.second->requestHeaders);
+        delete pair.second;
+    }
+    for (transfer* current : finished) {
+        delete current;
+    }
+    curl_multi_cleanup(multi);
+}
+
+void eventLoop::startTransfer(const string& url, const vector<string>& headers, chrono::milliseconds hedgeAfter,
+                              const function<bool()>& mayHedge, httpResponse* out, coroutine_handle<> awaiting) {
+    string id = url;
+    for (const string& header : headers) {
+        id += "\n" + header;
+    }
+
+    //same request already on its way -> wait for that one
+    auto running = inFlight.find(id);
+    if (running != inFlight.end()) {
+        running->second->waiters.emplace_back(out, awaiting);
+        return;
+    }
+
+    transfer* current = new transfer();
+    current->id = id;
+    current->requestHeaders = nullptr;
+    current->mayHedge = mayHedge;
+    current->hedgeTimer = hedgeTimers.end();
+    current->waiters.emplace_back(out, awaiting);
+    for (const string& header : headers) {
+        current->requestHeaders = curl_slist_append(current->requestHeaders, header.c_str());
+    }
+
+    current->request = make_unique<hedgedRequest>(http, multi, url, current->requestHeaders, current);
+    if (!current->request->start()) {
+        //nothing was started -> the waiter is resumed with the error on the next step
+        httpResponse failure;
+        failure.error = "could not start transfer";
+        completeTransfer(current, move(failure));
+        return;
+    }
+
+    if (hedgeAfter > chrono::milliseconds::zero() && mayHedge) {
+        current->hedgeTimer = hedgeTimers.emplace(clock::now() + hedgeAfter, current);
+    }
+    inFlight[id] = current;
+}
+
+void eventLoop::completeTransfer(transfer* current, httpResponse response) {
+    current->request.reset(); //a leg that lost is stopped
+
+    if (current->hedgeTimer != hedgeTimers.end()) {
+        hedgeTimers.erase(current->hedgeTimer);
+        current->hedgeTimer = hedgeTimers.end();
+    }
+    curl_slist_free_all(current->requestHeaders);
+    current->requestHeaders = nullptr;
+
+    current->response = move(response);
+    inFlight.erase(current->id);
+    finished.push_back(current);
+}
+
+void eventLoop::finishTransfers() {
+    int remaining = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi, &remaining)) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        transfer* current = nullptr;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &current);
+        if (current != nullptr && current->request->legDone(message->easy_handle, message->data.result)) {
+            completeTransfer(current, current->request->takeResult());
+        }
+    }
+
+    //waiters are resumed only after the bookkeeping, since they can start new transfers right away
+    vector<transfer*> ready;
+    ready.swap(finished);
+    for (transfer* current : ready) {
+        for (size_t i = 0; i < current->waiters.size(); i++) {
+            auto& waiter = current->waiters[i];
+            if (i + 1 == current->waiters.size()) {
+                *waiter.first = move(current->response);
+            } else {
+                *waiter.first = current->response;
+            }
+            waiter.second.resume();
+        }
+        delete current;
+    }
+}
+
+void eventLoop::fireHedges() {
+    while (!hedgeTimers.empty() && hedgeTimers.begin()->first <= clock::now()) {
+        transfer* current = hedgeTimers.begin()->second;
+        hedgeTimers.erase(hedgeTimers.begin());
+        current->hedgeTimer = hedgeTimers.end();
+        current->request->hedge(current->mayHedge);
+    }
+}
+
+eventLoop::clock::time_point eventLoop::nextDeadline() const {
+    clock::time_point deadline = clock::time_point::max();
+    if (!timers.empty()) {
+        deadline = timers.begin()->first;
+    }
+    if (!hedgeTimers.empty()) {
+        deadline = min(deadline, hedgeTimers.begin()->first);
+    }
+    return deadline;
+}
+
+void eventLoop::step() {
+    int running = 0;
+    fireHedges();
+    curl_multi_perform(multi, &running);
+    finishTransfers();
+
+    //wake up sleepers whose time has come (resuming one can add new timers, so take them one at a time)
+    while (!timers.empty() && timers.begin()->first <= clock::now()) {
+        coroutine_handle<> sleeper = timers.begin()->second;
+        timers.erase(timers.begin());
+        sleeper.resume();
+    }
+
+    if (!finished.empty()) {
+        return; //a waiter is ready to be resumed
+    }
+
+    //wait for socket activity or the next timer, whichever comes first
+    auto timeout = chrono::milliseconds(1000);
+    clock::time_point deadline = nextDeadline();
+    if (deadline != clock::time_point::max()) {
+        auto untilTimer = chrono::duration_cast<chrono::milliseconds>(deadline - clock::now());
+        timeout = max(chrono::milliseconds(0), min(timeout, untilTimer + chrono::milliseconds(1)));
+    }
+
+    if (!inFlight.empty()) {
+        size_t legs = 0;
+        for (const auto& pair : inFlight) {
+            legs += static_cast<size_t>(pair.second->request->running());
+        }
+
+        //transfers added by the coroutines resumed above only open their sockets once perform runs
+        curl_multi_perform(multi, &running);
+        if (static_cast<size_t>(running) < legs) {
+            return; //some finished already -> nothing to wait for
+        }
+        curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+    } else if (!timers.empty()) {
+        this_thread::sleep_for(timeout);
+    }
+}
+
+void eventLoop::runAll(vector<task<void>>& tasks) {
+    for (auto& t : tasks) {
+        t.start();
+    }
+
+    while (any_of(tasks.begin(), tasks.end(), [](const task<void>& t) { return !t.done(); })) {
+        step();
+    }
+
+    for (auto& t : tasks) {
+        t.result();
+    }
+}
@@ -0,0 +1,250 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <optional>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <curl/curl.h>
+#include "http.h"
+
+using namespace std;
+
+//coroutine based async requests
+// - task<T> is a lazy coroutine: it starts when it is awaited (or handed to an eventLoop) and resumes whoever
+//   awaited it when it finishes
+// - eventLoop runs on a single thread over libcurl's multi interface (non-blocking sockets), so many requests
+//   can be in flight while coroutines parse results and update the graph in between, without a thread per request
+
+template <typename T>
+class task;
+
+namespace detail {
+    //resumes the coroutine that awaited a task once the task is done
+    struct finalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        coroutine_handle<> await_suspend(coroutine_handle<Promise> finished) noexcept {
+            coroutine_handle<> continuation = finished.promise().continuation;
+            return continuation ? continuation : noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    struct promiseBase {
+        coroutine_handle<> continuation;
+        exception_ptr error;
+
+        suspend_always initial_suspend() noexcept { return {}; }
+        finalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { error = current_exception(); }
+    };
+}
+
+template <typename T>
+class task {
+public:
+    struct promise_type : detail::promiseBase {
+        optional<T> value;
+
+        task get_return_object() { return task(coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_value(T result) { value = move(result); }
+    };
+
+private:
+    coroutine_handle<promise_type> handle;
+
+public:
+    explicit task(coroutine_handle<promise_type> handle) : handle(handle) {}
+    task(task&& other) noexcept : handle(exchange(other.handle, nullptr)) {}
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool done() const { return !handle || handle.done(); }
+
+    //starts the task without awaiting it (it runs until its first suspension point)
+    void start() { handle.resume(); }
+
+    //result of a finished task (rethrows if the coroutine threw)
+    T result() {
+        if (handle.promise().error) {
+            rethrow_exception(handle.promise().error);
+        }
+        return move(*handle.promise().value);
+    }
+
+    //co_await support
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return result(); }
+};
+
+template <>
+class task<void> {
+public:
+    struct promise_type : detail::promiseBase {
+        task get_return_object() { return task(coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_void() {}
+    };
+
+private:
+    coroutine_handle<promise_type> handle;
+
+public:
+    explicit task(coroutine_handle<promise_type> handle) : handle(handle) {}
+    task(task&& other) noexcept : handle(exchange(other.handle, nullptr)) {}
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool done() const { return !handle || handle.done(); }
+    void start() { handle.resume(); }
+
+    void result() {
+        if (handle.promise().error) {
+            rethrow_exception(handle.promise().error);
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    void await_resume() { result(); }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//single threaded event loop: drives libcurl transfers and timers, resuming the coroutines waiting on them
+//identical urls requested while one is already in flight share that transfer
+//a transfer can be hedged: if it is still running after a delay, a duplicate request is sent and whichever
+//answers first is used
+class eventLoop {
+public:
+    using clock = chrono::steady_clock;
+
+private:
+    //a request in flight and the coroutines waiting for it
+    struct transfer {
+        string id; //url + request headers (identical requests share one transfer)
+        curl_slist* requestHeaders;
+        unique_ptr<hedgedRequest> request; //its legs on the multi handle (a hedged transfer has two)
+        function<bool()> mayHedge; //asked when the hedge delay has passed (empty -> never hedge)
+        multimap<clock::time_point, transfer*>::iterator hedgeTimer; //hedgeTimers.end() if there is none
+        httpResponse response; //result handed to the waiters
+        vector<pair<httpResponse*, coroutine_handle<>>> waiters; //(where to put the response, who to resume)
+    };
+
+    unique_ptr<httpClient> ownClient; //only when the loop wasn't given a client
+    httpClient& http; //connections come from (and go back to) its pool
+    CURLM* multi;
+    unordered_map<string, transfer*> inFlight; //(url + request headers, transfer)
+    vector<transfer*> finished; //transfers whose waiters are resumed on the next step
+    multimap<clock::time_point, coroutine_handle<>> timers; //coroutines sleeping until a point in time
+    multimap<clock::time_point, transfer*> hedgeTimers; //transfers to hedge if they are still running by then
+
+    //moves transfers forward and resumes everything that is ready, waiting at most until the next timer
+    void step();
+
+    //collects finished legs, completes their transfers and resumes the waiters
+    void finishTransfers();
+
+    //the transfer has its answer: stops the other leg and queues the waiters
+    void completeTransfer(transfer* current, httpResponse response);
+
+    //sends the duplicate request for transfers that reached their hedge delay
+    void fireHedges();
+
+    //earliest timer of either kind (clock::time_point::max() if there is none)
+    clock::time_point nextDeadline() const;
+
+public:
+    //awaitable returned by fetch
+    struct fetchAwaiter {
+        eventLoop& loop;
+        string url;
+        vector<string> headers;
+        chrono::milliseconds hedgeAfter;
+        function<bool()> mayHedge;
+        httpResponse response;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(coroutine_handle<> awaiting) {
+            loop.startTransfer(url, headers, hedgeAfter, mayHedge, &response, awaiting);
+        }
+        httpResponse await_resume() { return move(response); }
+    };
+
+    //awaitable returned by sleep
+    struct sleepAwaiter {
+        eventLoop& loop;
+        clock::time_point until;
+
+        bool await_ready() const noexcept { return clock::now() >= until; }
+        void await_suspend(coroutine_handle<> awaiting) { loop.timers.emplace(until, awaiting); }
+        void await_resume() const noexcept {}
+    };
+
+    //connections are taken from client's pool, so the loop shares its open connections, dns and tls sessions
+    //(without a client the loop has a pool of its own)
+    explicit eventLoop(httpClient& client);
+    eventLoop(); //constructor
+    ~eventLoop(); //destructor
+
+    eventLoop(const eventLoop&) = delete;
+    eventLoop& operator=(const eventLoop&) = delete;
+
+    //co_await loop.fetch(url) -> GET request on the loop, resumes with the response
+    //headers are extra request headers, hedgeAfter/mayHedge work like in httpClient::get
+    fetchAwaiter fetch(const string& url, const vector<string>& headers = {},
+                       chrono::milliseconds hedgeAfter = chrono::milliseconds::zero(), function<bool()> mayHedge = nullptr) {
+        return fetchAwaiter{*this, url, headers, hedgeAfter, move(mayHedge), httpResponse()};
+    }
+
+    //co_await loop.sleep(duration) -> resumes after duration without blocking other coroutines
+    sleepAwaiter sleep(clock::duration duration) { return sleepAwaiter{*this, clock::now() + duration}; }
+
+    //resumes a suspended coroutine on the next step of the loop (instead of inside the caller)
+    void wake(coroutine_handle<> waiting) { timers.emplace(clock::now(), waiting); }
+
+    //starts a transfer (or joins the identical one already in flight); called by fetchAwaiter
+    void startTransfer(const string& url, const vector<string>& headers, chrono::milliseconds hedgeAfter,
+                       const function<bool()>& mayHedge, httpResponse* out, coroutine_handle<> awaiting);
+
+    //runs the loop until t is done and returns its result
+    template <typename T>
+    T run(task<T>& t) {
+        t.start();
+        while (!t.done()) {
+            step();
+        }
+        return t.result();
+    }
+
+    //runs the loop until every task is done (they all make progress at the same time)
+    void runAll(vector<task<void>>& tasks);
+};
+
+#endif //ASYNC_H
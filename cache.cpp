@@ -0,0 +1,294 @@
+#include "cache.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "compress.h"
+
+#include "json.hpp"
+using json = nlohmann::json;
+
+//seconds since epoch
+static long long nowSeconds() {
+    return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+diskCache::diskCache(const string& directory, size_t maxBytes)
+    : directory(directory), maxBytes(maxBytes), totalBytes(0), defaultTtl(24 * 60 * 60), missingTtl(6 * 60 * 60), tempCounter(0),
+      readBytes(0), writtenBytes(0) {
+
+    //movie credits hardly ever change, searches can start matching new people and movies
+    ttls.push_back(make_pair("/movie/", 30LL * 24 * 60 * 60));
+    ttls.push_back(make_pair("/person/", 7LL * 24 * 60 * 60));
+    ttls.push_back(make_pair("/search/", 24LL * 60 * 60));
+
+    error_code ec;
+    filesystem::create_directories(this->directory, ec);
+
+    //add up the size of the existing entries and remove temporary files left behind by a crash
+    for (const auto& entry : filesystem::directory_iterator(this->directory, ec)) {
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+        if (entry.path().extension() == ".tmp") {
+            filesystem::remove(entry.path(), ec);
+            continue;
+        }
+        totalBytes += entry.file_size(ec);
+    }
+}
+
+string diskCache::normalizeKey(const string& request) {
+    size_t queryStart = request.find('?');
+    if (queryStart == string::npos) {
+        return request;
+    }
+
+    //split query into its parameters, dropping the api key
+    vector<string> params;
+    stringstream query(request.substr(queryStart + 1));
+    string param;
+    while (getline(query, param, '&')) {
+        if (!param.empty() && param.rfind("api_key=", 0) != 0) {
+            params.push_back(param);
+        }
+    }
+    sort(params.begin(), params.end());
+
+    string key = request.substr(0, queryStart);
+    for (size_t i = 0; i < params.size(); i++) {
+        key += (i == 0 ? "?" : "&") + params[i];
+    }
+    return key;
+}
+
+void diskCache::setTtl(const string& endpointPrefix, long long seconds) {
+    for (auto& ttl : ttls) {
+        if (ttl.first == endpointPrefix) {
+            ttl.second = seconds;
+            return;
+        }
+    }
+    ttls.insert(ttls.begin(), make_pair(endpointPrefix, seconds));
+}
+
+string diskCache::fileNameFor(const string& key) {
+    //64 bit FNV-1a hash of the key
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.json", hash);
+    return name;
+}
+
+void diskCache::setMissingTtl(long long seconds) {
+    missingTtl = seconds;
+}
+
+filesystem::path diskCache::pathFor(const string& key) const {
+    return directory / fileNameFor(key);
+}
+
+long long diskCache::ttlFor(const string& key) const {
+    for (const auto& ttl : ttls) {
+        if (key.rfind(ttl.first, 0) == 0) {
+            return ttl.second;
+        }
+    }
+    return defaultTtl;
+}
+
+bool diskCache::get(const string& key, string& body, bool& missing) {
+    bool stale = false;
+    validators check;
+    return lookup(key, body, missing, stale, check) && !stale;
+}
+
+bool diskCache::lookup(const string& key, string& body, bool& missing, bool& stale, validators& check) {
+    filesystem::path path = pathFor(key);
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    //first line is the header, the rest of the file is the response body
+    string headerLine;
+    if (!getline(file, headerLine)) {
+        return false;
+    }
+
+    json header = json::parse(headerLine, nullptr, false);
+    if (header.is_discarded() || header.value("key", "") != key) {
+        return false; //unreadable entry or hash collision with another key
+    }
+    missing = header.value("missing", false);
+    long long ttl = missing ? missingTtl : ttlFor(key);
+    stale = header.value("stored", 0LL) + ttl < nowSeconds();
+    check.etag = header.value("etag", "");
+    check.lastModified = header.value("last_modified", "");
+    if (stale && (missing || check.empty())) {
+        return false; //expired, and there is nothing to revalidate it with
+    }
+
+    if (missing) {
+        body.clear();
+        readBytes += headerLine.size();
+    } else {
+        string stored(istreambuf_iterator<char>(file), istreambuf_iterator<char>{});
+        readBytes += headerLine.size() + stored.size();
+        if (header.value("encoding", "") == "gzip") {
+            if (!gzipDecompress(stored, body)) {
+                return false; //damaged entry -> treated like a miss, the next put replaces it
+            }
+        } else {
+            body = move(stored);
+        }
+    }
+
+    //mark the entry as recently used (eviction removes the oldest files first)
+    error_code ec;
+    filesystem::last_write_time(path, filesystem::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void diskCache::put(const string& key, const string& body, const validators& check) {
+    write(key, body, false, check);
+}
+
+void diskCache::putMissing(const string& key) {
+    write(key, "", true, validators());
+}
+
+bool diskCache::refresh(const string& key) {
+    ifstream file(pathFor(key), ios::binary);
+    string headerLine;
+    if (!file.is_open() || !getline(file, headerLine)) {
+        return false;
+    }
+
+    json header = json::parse(headerLine, nullptr, false);
+    if (header.is_discarded() || header.value("key", "") != key) {
+        return false;
+    }
+
+    //same body (still compressed), new time stored
+    string stored(istreambuf_iterator<char>(file), istreambuf_iterator<char>{});
+    file.close();
+    header["stored"] = nowSeconds();
+    return writeFile(key, header.dump() + "\n", stored);
+}
+
+void diskCache::write(const string& key, const string& body, bool missing, const validators& check) {
+    json header;
+    header["key"] = key;
+    header["stored"] = nowSeconds();
+    string stored;
+    if (missing) {
+        header["missing"] = true;
+    } else {
+        stored = gzipCompress(body);
+        if (!stored.empty()) {
+            header["encoding"] = "gzip";
+        } else {
+            stored = body; //compression failed -> plain entry
+        }
+    }
+    if (!check.etag.empty()) {
+        header["etag"] = check.etag;
+    }
+    if (!check.lastModified.empty()) {
+        header["last_modified"] = check.lastModified;
+    }
+
+    writeFile(key, header.dump() + "\n", stored);
+}
+
+bool diskCache::writeFile(const string& key, const string& headerLine, const string& stored) {
+    filesystem::path path = pathFor(key);
+
+    //write everything to a temporary file first
+    stringstream tempName;
+    tempName << path.filename().string() << "." << this_thread::get_id() << "." << tempCounter++ << ".tmp";
+    filesystem::path tempPath = directory / tempName.str();
+    {
+        ofstream file(tempPath, ios::binary | ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << headerLine << stored;
+        file.flush();
+        if (!file) {
+            file.close();
+            error_code ec;
+            filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    lock_guard<mutex> lock(sizeMutex);
+    error_code ec;
+    size_t oldSize = filesystem::exists(path, ec) ? filesystem::file_size(path, ec) : 0;
+
+    //rename replaces the old entry in one step -> readers see the old entry or the new one, never half of one
+    filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    writtenBytes += headerLine.size() + stored.size();
+    totalBytes = totalBytes - min(oldSize, totalBytes) + headerLine.size() + stored.size();
+    if (totalBytes > maxBytes) {
+        evict();
+    }
+    return true;
+}
+
+void diskCache::evict() {
+    struct entryInfo {
+        filesystem::file_time_type lastUsed;
+        size_t size;
+        filesystem::path path;
+    };
+
+    vector<entryInfo> entries;
+    error_code ec;
+    for (const auto& entry : filesystem::directory_iterator(directory, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == ".json") {
+            entries.push_back({entry.last_write_time(ec), entry.file_size(ec), entry.path()});
+        }
+    }
+
+    //oldest first
+    sort(entries.begin(), entries.end(), [](const entryInfo& a, const entryInfo& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    size_t target = maxBytes / 10 * 9;
+    totalBytes = 0;
+    for (const auto& entry : entries) {
+        totalBytes += entry.size;
+    }
+
+    for (const auto& entry : entries) {
+        if (totalBytes <= target) {
+            break;
+        }
+        if (filesystem::remove(entry.path, ec)) {
+            totalBytes -= entry.size;
+        }
+    }
+}
+
+size_t diskCache::size() {
+    lock_guard<mutex> lock(sizeMutex);
+    return totalBytes;
+}
@@ -0,0 +1,249 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <chrono>
+
+using namespace std;
+
+//persistent on-disk cache of api responses
+// - one file per request, named after a hash of the normalized request (endpoint + sorted parameters, no api key)
+// - each endpoint has its own time to live (e.g. search results expire sooner than movie credits)
+// - when the cache grows over its size budget, the least recently used files are removed
+// - entries are written to a temporary file and renamed into place, so a crash never leaves a half written entry
+// - bodies are stored gzip compressed (entries written before that are still read as plain text)
+// - the server's validators (ETag, Last-Modified) are kept with each entry, so an expired entry can be
+//   revalidated with a conditional request instead of downloaded again
+class diskCache {
+public:
+    //validators the server sent with a response
+    struct validators {
+        string etag;
+        string lastModified;
+
+        bool empty() const { return etag.empty() && lastModified.empty(); }
+    };
+
+private:
+    filesystem::path directory;
+    size_t maxBytes; //size budget for all entries
+    size_t totalBytes; //current size of all entries
+    long long defaultTtl; //in seconds
+    long long missingTtl; //time to live of "known missing" entries (shorter, the lookup may start working)
+    vector<pair<string, long long>> ttls; //(endpoint prefix, time to live in seconds) -> first match wins
+    mutex sizeMutex;
+    atomic<unsigned> tempCounter; //makes temporary file names unique between threads
+    atomic<long long> readBytes; //bytes of entries read back from disk (as stored, i.e. compressed)
+    atomic<long long> writtenBytes; //bytes of entries written to disk
+
+    //file that stores the entry for a key
+    filesystem::path pathFor(const string& key) const;
+
+    //time to live of the endpoint the key belongs to
+    long long ttlFor(const string& key) const;
+
+    //removes least recently used entries until the cache is back under 90% of its budget
+    //(assumes sizeMutex is held)
+    void evict();
+
+    //builds the entry for a body and writes it
+    void write(const string& key, const string& body, bool missing, const validators& check);
+
+    //writes an entry atomically (temporary file + rename), returns false if it couldn't be written
+    bool writeFile(const string& key, const string& headerLine, const string& stored);
+
+public:
+    diskCache(const string& directory, size_t maxBytes = 256 * 1024 * 1024); //constructor
+
+    //turns a request into a cache key: "/movie/5/credits?language=en&api_key=X" => "/movie/5/credits?language=en"
+    //(api key removed, remaining parameters sorted so their order doesn't matter)
+    static string normalizeKey(const string& request);
+
+    //file name for a key: 64 bit FNV-1a hash of it in hex, e.g. "0dfda5a2139036b0.json"
+    static string fileNameFor(const string& key);
+
+    //sets the time to live for every key starting with endpointPrefix (e.g. "/search/")
+    void setTtl(const string& endpointPrefix, long long seconds);
+
+    //sets the time to live for "known missing" entries
+    void setMissingTtl(long long seconds);
+
+    //if there is a fresh entry for key, copies it into body and returns true
+    //missing is set if the entry says the lookup has no result (body is left empty then)
+    bool get(const string& key, string& body, bool& missing);
+
+    //same as get, but an expired entry that has validators is returned as well (with stale set), so the
+    //caller can ask the server whether it changed
+    bool lookup(const string& key, string& body, bool& missing, bool& stale, validators& check);
+
+    //stores body under key (replacing any older entry), with the validators the server sent for it
+    void put(const string& key, const string& body, const validators& check = validators());
+
+    //marks an entry as fresh again without touching its body (the server answered 304 not modified)
+    bool refresh(const string& key);
+
+    //remembers that key has no result (replacing any older entry)
+    void putMissing(const string& key);
+
+    //current size of all entries in bytes
+    size_t size();
+
+    //bytes read from and written to disk so far
+    long long bytesRead() const { return readBytes; }
+    long long bytesWritten() const { return writtenBytes; }
+};
+
+//in-memory set of lookups known to have no result (unknown actor, movie without cast, 404, ...)
+//entries expire after their own time to live, which is shorter than the one for real data
+class negativeCache {
+private:
+    unordered_map<string, chrono::steady_clock::time_point> expiry; //(key, when the entry stops counting)
+    long long ttlSeconds;
+    size_t maxEntries;
+    mutable mutex cacheMutex;
+
+public:
+    negativeCache(long long ttlSeconds = 6 * 60 * 60, size_t maxEntries = 100000)
+        : ttlSeconds(ttlSeconds), maxEntries(maxEntries) {}
+
+    bool contains(const string& key) {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = expiry.find(key);
+        if (it == expiry.end()) {
+            return false;
+        }
+        if (it->second < chrono::steady_clock::now()) {
+            expiry.erase(it);
+            return false;
+        }
+        return true;
+    }
+
+    void add(const string& key) {
+        lock_guard<mutex> lock(cacheMutex);
+        auto now = chrono::steady_clock::now();
+        if (expiry.size() >= maxEntries) {
+            //drop expired entries first, and everything if that isn't enough
+            erase_if(expiry, [&](const auto& entry) { return entry.second < now; });
+            if (expiry.size() >= maxEntries) {
+                expiry.clear();
+            }
+        }
+        expiry[key] = now + chrono::seconds(ttlSeconds);
+    }
+
+    void setTtl(long long seconds) {
+        lock_guard<mutex> lock(cacheMutex);
+        ttlSeconds = seconds;
+    }
+};
+
+//in-memory least recently used cache with a size budget in bytes
+//values are stored as shared_ptr<const V>, so a hit is a pointer copy and readers never copy under the lock
+//every method locks, so it can be shared between threads
+template <typename K, typename V>
+class lruCache {
+private:
+    struct entry {
+        K key;
+        shared_ptr<const V> value;
+        size_t bytes;
+    };
+
+    list<entry> order; //most recently used first
+    unordered_map<K, typename list<entry>::iterator> index; //(key, position in order)
+    size_t maxBytes;
+    size_t totalBytes;
+    function<size_t(const V&)> sizeOf; //estimates how much memory a value uses
+    mutable mutex cacheMutex;
+    atomic<long long> hits;
+    atomic<long long> misses;
+
+    //drops least recently used entries until the cache fits in its budget (assumes cacheMutex is held)
+    void shrink() {
+        while (totalBytes > maxBytes && !order.empty()) {
+            totalBytes -= order.back().bytes;
+            index.erase(order.back().key);
+            order.pop_back();
+        }
+    }
+
+public:
+    lruCache(size_t maxBytes, function<size_t(const V&)> sizeOf)
+        : maxBytes(maxBytes), totalBytes(0), sizeOf(sizeOf), hits(0), misses(0) {}
+
+    //returns the value stored under key (and marks it as recently used), or nullptr if there is none
+    shared_ptr<const V> get(const K& key) {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            misses++;
+            return nullptr;
+        }
+        order.splice(order.begin(), order, it->second);
+        hits++;
+        return it->second->value;
+    }
+
+    //same as get, but doesn't count as a hit or miss and doesn't change the eviction order
+    shared_ptr<const V> peek(const K& key) const {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = index.find(key);
+        return it == index.end() ? nullptr : it->second->value;
+    }
+
+    //stores value under key (replacing any older value) and returns the stored pointer
+    shared_ptr<const V> put(const K& key, V value) {
+        size_t bytes = sizeof(entry) + sizeOf(value);
+        auto stored = make_shared<const V>(move(value));
+
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            totalBytes -= it->second->bytes;
+            order.erase(it->second);
+            index.erase(it);
+        }
+        if (bytes > maxBytes) {
+            return stored; //would never fit -> don't keep it
+        }
+
+        order.push_front(entry{key, stored, bytes});
+        index[key] = order.begin();
+        totalBytes += bytes;
+        shrink();
+        return stored;
+    }
+
+    //changes the size budget (evicting entries if the cache is now too big)
+    void setMaxBytes(size_t bytes) {
+        lock_guard<mutex> lock(cacheMutex);
+        maxBytes = bytes;
+        shrink();
+    }
+
+    void clear() {
+        lock_guard<mutex> lock(cacheMutex);
+        order.clear();
+        index.clear();
+        totalBytes = 0;
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lock(cacheMutex);
+        return totalBytes;
+    }
+
+    long long hitCount() const { return hits; }
+    long long missCount() const { return misses; }
+};
+
+#endif //CACHE_H
@@ -0,0 +1,98 @@
+#include "compress.h"
+
+#include <zlib.h>
+#include <cstring>
+
+string gzipCompress(const string& data) {
+    z_stream stream = {};
+    //15 window bits + 16 -> gzip header instead of zlib header
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return "";
+    }
+
+    string out;
+    out.resize(deflateBound(&stream, data.size()) + 32); //gzip header and trailer are not part of deflateBound
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END ? out : "";
+}
+
+bool gzipDecompress(const string& data, string& out) {
+    z_stream stream = {};
+    //15 window bits + 32 -> detects gzip or zlib header automatically
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return false;
+    }
+
+    out.clear();
+    out.reserve(data.size() * 6); //typical ratio for json, avoids most regrowing
+
+    char chunk[16 * 1024];
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    int result = Z_OK;
+    while (result == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef*>(chunk);
+        stream.avail_out = sizeof(chunk);
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END) {
+            break;
+        }
+        out.append(chunk, sizeof(chunk) - stream.avail_out);
+        if (result == Z_OK && stream.avail_in == 0 && stream.avail_out != 0) {
+            result = Z_DATA_ERROR; //input ended before the end of the stream
+        }
+    }
+
+    inflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+gzipLineReader::gzipLineReader(const string& path) {
+    file = gzopen(path.c_str(), "rb"); //files without a gzip header are read as they are
+    if (file != nullptr) {
+        gzbuffer(file, 256 * 1024);
+    }
+}
+
+gzipLineReader::~gzipLineReader() {
+    if (file != nullptr) {
+        gzclose(file);
+    }
+}
+
+bool gzipLineReader::getline(string& line) {
+    line.clear();
+    if (file == nullptr) {
+        return false;
+    }
+
+    //lines longer than the chunk (big credits responses) are put together from several reads
+    char chunk[64 * 1024];
+    while (gzgets(file, chunk, sizeof(chunk)) != nullptr) {
+        size_t length = strlen(chunk);
+        line.append(chunk, length);
+        if (length > 0 && chunk[length - 1] == '\n') {
+            line.pop_back();
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+    }
+
+    int code = Z_OK;
+    const char* message = gzerror(file, &code);
+    if (code != Z_OK) {
+        error = message;
+        return false;
+    }
+    return !line.empty(); //last line without a line break
+}
@@ -0,0 +1,42 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <string>
+
+using namespace std;
+
+//gzip helpers (zlib) for cache entries on disk and bulk import files
+//credits responses are verbose json and shrink 5-10x, so compressed entries let the same disk budget hold many more
+
+//returns data compressed in gzip format
+string gzipCompress(const string& data);
+
+//inflates gzip or zlib data in fixed size chunks into out, returns false if data is not valid compressed data
+bool gzipDecompress(const string& data, string& out);
+
+struct gzFile_s; //zlib's file handle, kept opaque so zlib.h stays out of this header
+
+//reads a gzip (or plain text) file one line at a time, inflating a buffer at a time
+//-> a multi GB export is never in memory as a whole
+class gzipLineReader {
+private:
+    gzFile_s* file;
+    string error;
+
+public:
+    gzipLineReader(const string& path); //constructor
+    ~gzipLineReader(); //destructor
+
+    gzipLineReader(const gzipLineReader&) = delete;
+    gzipLineReader& operator=(const gzipLineReader&) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+
+    //reads the next line without its line break, returns false at the end of the file or on a read error
+    bool getline(string& line);
+
+    //read error (e.g. truncated gzip data), empty if the file was read to the end
+    const string& lastError() const { return error; }
+};
+
+#endif //COMPRESS_H
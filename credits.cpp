@@ -0,0 +1,256 @@
+#include "credits.h"
+
+bool creditsSaxHandler::atCastParent() const {
+    if (stack.size() != castParent.size() + 1) {
+        return false;
+    }
+    for (size_t i = 0; i < castParent.size(); i++) {
+        if (!stack[i].isObject || stack[i].key != castParent[i]) {
+            return false;
+        }
+    }
+    return stack.back().isObject && stack.back().key == "cast";
+}
+
+void creditsSaxHandler::value(const std::string* text, long long number, bool isNumber) {
+    if (stack.empty() || !stack.back().isObject) {
+        return; //values inside arrays (e.g. genre_ids) are never needed
+    }
+    const std::string& field = stack.back().key;
+
+    //field of a cast entry: [... cast array][entry object]
+    if (castLevel >= 0 && stack.size() == static_cast<size_t>(castLevel) + 2) {
+        if (isNumber) {
+            if (field == "id") {
+                entry.id = static_cast<int>(number);
+            } else if (field == "order") {
+                entry.order = static_cast<int>(number);
+            }
+        } else if (text != nullptr) {
+            if (field == "name") {
+                entry.name = *text;
+            } else if (field == "profile_path") {
+                entry.profile_path = *text;
+            } else if (field == "title") {
+                entry.title = *text;
+            } else if (field == "release_date") {
+                entry.release_date = *text;
+            } else if (field == "poster_path") {
+                entry.poster_path = *text;
+            } else if (field == "character") {
+                //only the markers are needed, the character name itself is never copied
+                entry.uncredited = text->find("(uncredited)") != std::string::npos;
+                entry.voice = text->find("(voice)") != std::string::npos;
+            }
+        }
+        return;
+    }
+
+    if (stack.size() == 1) {
+        topLevelField(field, text, number, isNumber);
+    }
+}
+
+bool creditsSaxHandler::null() {
+    value(nullptr, 0, false);
+    return true;
+}
+
+bool creditsSaxHandler::boolean(bool) {
+    value(nullptr, 0, false);
+    return true;
+}
+
+bool creditsSaxHandler::number_integer(number_integer_t val) {
+    value(nullptr, val, true);
+    return true;
+}
+
+bool creditsSaxHandler::number_unsigned(number_unsigned_t val) {
+    value(nullptr, static_cast<long long>(val), true);
+    return true;
+}
+
+bool creditsSaxHandler::number_float(number_float_t, const string_t&) {
+    value(nullptr, 0, false); //no float field is used (popularity, vote_average, ...)
+    return true;
+}
+
+bool creditsSaxHandler::string(string_t& val) {
+    value(&val, 0, false);
+    return true;
+}
+
+bool creditsSaxHandler::binary(binary_t&) {
+    return true;
+}
+
+bool creditsSaxHandler::start_object(size_t) {
+    //new entry of the cast array
+    if (castLevel >= 0 && stack.size() == static_cast<size_t>(castLevel) + 1) {
+        entry.reset();
+    }
+    stack.push_back(frame{true, ""});
+    return true;
+}
+
+bool creditsSaxHandler::key(string_t& val) {
+    //keys only matter on the way down to the cast array and inside cast entries
+    //(saves a string copy for every key of every crew entry)
+    bool onCastPath = stack.size() <= castParent.size() + 1;
+    bool inCastEntry = castLevel >= 0 && stack.size() == static_cast<size_t>(castLevel) + 2;
+    if (onCastPath || inCastEntry) {
+        stack.back().key = val;
+    }
+    return true;
+}
+
+bool creditsSaxHandler::end_object() {
+    stack.pop_back();
+    if (castLevel >= 0 && stack.size() == static_cast<size_t>(castLevel) + 1) {
+        //entries the policy drops never become an Actor/Movie
+        if (policy.keeps(entry.order, entry.uncredited, entry.voice)) {
+            finishEntry(entry);
+        } else {
+            dropped++;
+        }
+    }
+    return true;
+}
+
+bool creditsSaxHandler::start_array(size_t) {
+    if (castLevel < 0 && atCastParent()) {
+        castLevel = static_cast<int>(stack.size());
+    }
+    stack.push_back(frame{false, ""});
+    return true;
+}
+
+bool creditsSaxHandler::end_array() {
+    stack.pop_back();
+    if (castLevel >= 0 && stack.size() == static_cast<size_t>(castLevel)) {
+        castLevel = -1; //left the cast array -> the crew array that follows is only tokenized
+    }
+    return true;
+}
+
+bool creditsSaxHandler::parse_error(size_t, const std::string&, const nlohmann::detail::exception& ex) {
+    error = ex.what();
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//handler for /movie/{id}/credits -> one Actor per cast entry
+class castHandler : public creditsSaxHandler {
+private:
+    vector<Actor>& cast;
+
+protected:
+    void finishEntry(creditEntry& entry) override {
+        cast.emplace_back(entry.id, move(entry.name), move(entry.profile_path));
+    }
+
+public:
+    castHandler(vector<Actor>& cast, const castPolicy& policy) : creditsSaxHandler({}, policy), cast(cast) {}
+};
+
+//handler for /person/{id}/movie_credits -> one Movie per cast entry (and the person record if asked for)
+class filmographyHandler : public creditsSaxHandler {
+private:
+    vector<Movie>& movies;
+    Actor* person;
+
+protected:
+    void finishEntry(creditEntry& entry) override {
+        std::string date = entry.release_date.empty() ? "No release date" : move(entry.release_date);
+        movies.emplace_back(entry.id, move(entry.title), move(date), move(entry.poster_path));
+    }
+
+    void topLevelField(const std::string& key, const std::string* text, long long number, bool isNumber) override {
+        if (person == nullptr) {
+            return;
+        }
+        if (key == "id" && isNumber) {
+            person->id = static_cast<int>(number);
+        } else if (key == "name" && text != nullptr) {
+            person->name = *text;
+        } else if (key == "profile_path") {
+            person->profile_path = text != nullptr ? *text : "";
+        }
+    }
+
+public:
+    filmographyHandler(vector<Movie>& movies, Actor* person, const castPolicy& policy)
+        : creditsSaxHandler(person != nullptr ? vector<std::string>{"movie_credits"} : vector<std::string>{}, policy),
+          movies(movies), person(person) {}
+};
+
+//handler for /movie/{id}?append_to_response=credits -> the movie record and one Actor per cast entry
+class movieCreditsHandler : public creditsSaxHandler {
+private:
+    Movie& movie;
+    vector<Actor>& cast;
+
+protected:
+    void finishEntry(creditEntry& entry) override {
+        cast.emplace_back(entry.id, move(entry.name), move(entry.profile_path));
+    }
+
+    void topLevelField(const std::string& key, const std::string* text, long long number, bool isNumber) override {
+        if (key == "id" && isNumber) {
+            movie.id = static_cast<int>(number);
+        } else if (key == "title" && text != nullptr) {
+            movie.title = *text;
+        } else if (key == "release_date" && text != nullptr) {
+            movie.release_date = *text;
+        } else if (key == "poster_path") {
+            movie.poster_path = text != nullptr ? *text : "";
+        }
+    }
+
+public:
+    movieCreditsHandler(Movie& movie, vector<Actor>& cast, const castPolicy& policy)
+        : creditsSaxHandler({"credits"}, policy), movie(movie), cast(cast) {}
+};
+
+bool parseCast(const string& response, vector<Actor>& cast, string& error, const castPolicy& policy, size_t* dropped) {
+    castHandler handler(cast, policy);
+    if (!json::sax_parse(response, &handler)) {
+        cast.clear();
+        error = handler.error;
+        return false;
+    }
+    if (dropped != nullptr) {
+        *dropped = handler.dropped;
+    }
+    return true;
+}
+
+bool parseFilmography(const string& response, vector<Movie>& movies, string& error, Actor* person,
+                      const castPolicy& policy, size_t* dropped) {
+    filmographyHandler handler(movies, person, policy);
+    if (!json::sax_parse(response, &handler)) {
+        movies.clear();
+        error = handler.error;
+        return false;
+    }
+    if (dropped != nullptr) {
+        *dropped = handler.dropped;
+    }
+    return true;
+}
+
+bool parseMovieCredits(const string& response, Movie& movie, vector<Actor>& cast, string& error,
+                       const castPolicy& policy, size_t* dropped) {
+    movieCreditsHandler handler(movie, cast, policy);
+    if (!json::sax_parse(response, &handler)) {
+        cast.clear();
+        error = handler.error;
+        return false;
+    }
+    if (dropped != nullptr) {
+        *dropped = handler.dropped;
+    }
+    return true;
+}
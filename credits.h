@@ -0,0 +1,112 @@
+#ifndef CREDITS_H
+#define CREDITS_H
+
+#include <string>
+#include <vector>
+#include "api.h"
+
+using namespace std;
+
+//streaming (SAX) parsing of TMDB credits responses
+//instead of building a whole json document, the parser walks the tokens once and only copies the few fields
+//we use out of the "cast" array -> everything else (crew, character names, popularity, ...) is skipped
+
+//fields of one "cast" entry we care about (movie credits have name/profile_path, person credits have title/date/poster)
+struct creditEntry {
+    int id;
+    string name;
+    string profile_path;
+    string title;
+    string release_date;
+    string poster_path;
+    int order; //billing position in the movie (0 = top billed, -1 if the response has none)
+    bool uncredited; //character is marked "(uncredited)"
+    bool voice; //character is marked "(voice)"
+
+    creditEntry() : id(0), name("Unknown name"), title("Unknown title"), order(-1), uncredited(false), voice(false) {}
+
+    //back to the defaults, keeping the strings' capacity (one entry is reused for the whole array)
+    void reset() {
+        id = 0;
+        name = "Unknown name";
+        profile_path.clear();
+        title = "Unknown title";
+        release_date.clear();
+        poster_path.clear();
+        order = -1;
+        uncredited = false;
+        voice = false;
+    }
+};
+
+//sax handler that calls finishEntry for every object of a "cast" array
+//castParent is the path of keys leading to the object holding "cast" ({} for a plain credits response,
+//{"movie_credits"} for a person response with append_to_response=movie_credits)
+class creditsSaxHandler : public nlohmann::json_sax<json> {
+private:
+    struct frame {
+        bool isObject;
+        std::string key; //last key seen in this object
+    };
+
+    vector<std::string> castParent;
+    castPolicy policy;
+    vector<frame> stack; //containers we are currently inside of
+    int castLevel; //stack index of the "cast" array while we are inside it, -1 otherwise
+    creditEntry entry; //cast entry being read
+
+    //a primitive value was read (text is null for numbers, both are empty for null/bool values)
+    //-> stores it if it belongs to a cast entry, or passes it on if it belongs to the top level object
+    void value(const std::string* text, long long number, bool isNumber);
+
+    //true if the object on top of the stack is the one that holds the cast array
+    bool atCastParent() const;
+
+protected:
+    //called after each complete cast entry the policy keeps (fields can be moved out of entry)
+    virtual void finishEntry(creditEntry& entry) = 0;
+
+    //called for primitive values of the top level object (e.g. the person's name in a person response)
+    virtual void topLevelField(const std::string& /*key*/, const std::string* /*text*/, long long /*number*/, bool /*isNumber*/) {}
+
+public:
+    creditsSaxHandler(vector<std::string> castParent = {}, castPolicy policy = castPolicy())
+        : castParent(move(castParent)), policy(policy), castLevel(-1), dropped(0) {}
+    virtual ~creditsSaxHandler() = default;
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t& s) override;
+    bool string(string_t& val) override;
+    bool binary(binary_t& val) override;
+    bool start_object(size_t elements) override;
+    bool key(string_t& val) override;
+    bool end_object() override;
+    bool start_array(size_t elements) override;
+    bool end_array() override;
+    bool parse_error(size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) override;
+
+    std::string error; //parse error message (empty if parsing succeeded)
+    size_t dropped; //cast entries the policy left out
+};
+
+//parses a /movie/{id}/credits response into its cast, returns false if the response is not valid json
+//entries the policy doesn't keep are skipped (dropped, if given, is set to how many)
+bool parseCast(const string& response, vector<Actor>& cast, string& error,
+               const castPolicy& policy = castPolicy(), size_t* dropped = nullptr);
+
+//parses a /person/{id}/movie_credits response into the movies in its cast, returns false if the response is not valid json
+//if person is given, the response is expected to be /person/{id}?append_to_response=movie_credits and the person
+//record is filled in as well
+//the policy applies to the person's own billing in each movie, so both sides of an edge agree
+bool parseFilmography(const string& response, vector<Movie>& movies, string& error, Actor* person = nullptr,
+                      const castPolicy& policy = castPolicy(), size_t* dropped = nullptr);
+
+//parses a /movie/{id}?append_to_response=credits response into the movie record and its cast (used by the bulk
+//importer, one response per line of a credits dump), returns false if the response is not valid json
+bool parseMovieCredits(const string& response, Movie& movie, vector<Actor>& cast, string& error,
+                       const castPolicy& policy = castPolicy(), size_t* dropped = nullptr);
+
+#endif //CREDITS_H
@@ -0,0 +1,278 @@
+#include <iostream>
+#include "credits.h"
+
+using namespace std;
+
+//checks the streaming credits parsers against the json document parsing they replaced
+//(every response is parsed both ways and the results have to match)
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cout << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+//the old parsing, entry by entry as it was done on the json document (plus the policy, applied to the same fields)
+bool domKeeps(const json& entry, const castPolicy& policy) {
+    int order = entry.contains("order") && entry["order"].is_number() ? entry["order"].get<int>() : -1;
+    string character = entry.contains("character") && entry["character"].is_string() ? entry["character"].get<string>() : "";
+    return policy.keeps(order, character.find("(uncredited)") != string::npos, character.find("(voice)") != string::npos);
+}
+
+vector<Actor> domCast(const json& creditData, const castPolicy& policy = castPolicy()) {
+    vector<Actor> actors;
+    if (creditData.contains("cast")) {
+        for (const auto& actor : creditData["cast"]) {
+            if (!domKeeps(actor, policy)) {
+                continue;
+            }
+            int id = actor.value("id", 0);
+            string name = actor.value("name", "Unknown name");
+            string profile_path = actor.contains("profile_path") && !actor["profile_path"].is_null() ? actor["profile_path"].get<string>() : "";
+
+            actors.emplace_back(id, name, profile_path);
+        }
+    }
+    return actors;
+}
+
+vector<Movie> domFilmography(const json& creditData, const castPolicy& policy = castPolicy()) {
+    vector<Movie> movies;
+    if (creditData.contains("cast")) {
+        for (const auto& movie : creditData["cast"]) {
+            if (!domKeeps(movie, policy)) {
+                continue;
+            }
+            int id = movie.value("id", 0);
+            string title = movie.value("title", "Unknown title");
+            string date = (movie.contains("release_date") &&
+                           !movie["release_date"].is_null() &&
+                           !movie["release_date"].get<string>().empty())
+                          ? movie["release_date"].get<string>()
+                          : "No release date";
+            string poster_path = movie.contains("poster_path") && !movie["poster_path"].is_null() ? movie["poster_path"].get<string>() : "";
+
+            movies.emplace_back(id, title, date, poster_path);
+        }
+    }
+    return movies;
+}
+
+bool sameCast(const vector<Actor>& a, const vector<Actor>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].id != b[i].id || a[i].name != b[i].name || a[i].profile_path != b[i].profile_path) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sameMovies(const vector<Movie>& a, const vector<Movie>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].id != b[i].id || a[i].title != b[i].title || a[i].release_date != b[i].release_date ||
+            a[i].poster_path != b[i].poster_path) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//a movie credits response: crew entries, nested arrays/objects inside cast entries and a "cast" key that is
+//not the cast array (inside an entry and inside another object) must not add or change anyone
+const string movieCredits = R"json({
+    "id": 550,
+    "crew": [{"id": 7, "name": "Crew Member", "profile_path": "/crew.jpg", "job": "Director"}],
+    "other": {"cast": [{"id": 8, "name": "Not Cast"}]},
+    "cast": [
+        {"id": 1, "name": "Lead", "profile_path": "/lead.jpg", "character": "Hero", "order": 0,
+         "known_for": [{"id": 90, "name": "Known For", "cast": [{"id": 91, "name": "Deeper"}]}],
+         "details": {"id": 92, "name": "Detail", "profile_path": "/detail.jpg"}, "popularity": 12.5},
+        {"id": 2, "name": "Second", "profile_path": null, "character": "Sidekick (voice)", "order": 1,
+         "genre_ids": [1, 2, 3], "adult": false},
+        {"id": 3, "name": "Third", "character": "Bystander (uncredited)", "order": 2},
+        {"id": 4, "profile_path": "/noname.jpg", "order": 3}
+    ]
+})json";
+
+void testCast() {
+    vector<Actor> cast;
+    string error;
+    check(parseCast(movieCredits, cast, error), "movie credits parse");
+    check(sameCast(cast, domCast(json::parse(movieCredits))), "cast matches the document parsing");
+    check(cast.size() == 4, "cast has 4 entries (crew and nested cast skipped)");
+    check(cast.size() == 4 && cast[0].name == "Lead" && cast[0].profile_path == "/lead.jpg",
+          "nested fields don't overwrite the entry they are in");
+    check(cast.size() == 4 && cast[1].profile_path.empty(), "null profile_path is empty");
+    check(cast.size() == 4 && cast[3].name == "Unknown name", "missing name is Unknown name");
+
+    //policies: depth counts billing positions, markers come from the character
+    struct policyCase {
+        castPolicy policy;
+        size_t kept;
+        const char* what;
+    };
+    const policyCase cases[] = {
+        {castPolicy(2), 2, "depth 2 keeps orders 0 and 1"},
+        {castPolicy(0), 0, "depth 0 keeps nobody"},
+        {castPolicy(-1, true, false), 3, "uncredited roles dropped"},
+        {castPolicy(-1, false, true), 3, "voice roles dropped"},
+        {castPolicy(3, true, true), 1, "depth and both markers together"},
+    };
+    for (const policyCase& c : cases) {
+        vector<Actor> kept;
+        size_t dropped = 0;
+        check(parseCast(movieCredits, kept, error, c.policy, &dropped), string(c.what) + ": parses");
+        check(sameCast(kept, domCast(json::parse(movieCredits), c.policy)), string(c.what) + ": matches the document parsing");
+        check(kept.size() == c.kept && dropped == 4 - c.kept, c.what);
+    }
+
+    //null name: the document parsing threw on it (and lost the whole cast), the stream keeps the default
+    vector<Actor> nullName;
+    check(parseCast(R"json({"cast": [{"id": 5, "name": null, "profile_path": null}, {"id": 6, "name": "Kept"}]})json", nullName, error),
+          "null name parses");
+    check(nullName.size() == 2 && nullName[0].name == "Unknown name" && nullName[0].profile_path.empty() &&
+          nullName[1].name == "Kept", "null name is Unknown name and the rest of the cast is kept");
+
+    //no cast at all, and invalid json
+    vector<Actor> empty;
+    check(parseCast(R"json({"id": 1, "crew": []})json", empty, error) && empty.empty(), "response without cast is empty");
+    check(!parseCast(R"json({"cast": [{"id": 1, "name": "Cut)json", empty, error) && empty.empty() && !error.empty(),
+          "truncated response fails with an error");
+}
+
+//a /person/{id}/movie_credits response (the cast is at the top level)
+const string personCredits = R"json({
+    "id": 31,
+    "crew": [{"id": 70, "title": "Directed", "release_date": "2001-01-01", "poster_path": "/crew.jpg"}],
+    "cast": [
+        {"id": 10, "title": "First", "release_date": "1994-07-06", "poster_path": "/first.jpg", "order": 0,
+         "character": "Forrest", "genre_ids": [18, 35], "belongs_to": {"id": 99, "title": "Collection"}},
+        {"id": 11, "title": "Second", "release_date": "", "poster_path": null, "order": 5, "character": "Woody (voice)"},
+        {"id": 12, "title": "Third", "release_date": null, "order": 30, "character": "Himself (uncredited)"},
+        {"id": 13, "release_date": "2020-01-01"}
+    ]
+})json";
+
+void testFilmography() {
+    vector<Movie> movies;
+    string error;
+    check(parseFilmography(personCredits, movies, error), "person credits parse");
+    check(sameMovies(movies, domFilmography(json::parse(personCredits))), "filmography matches the document parsing");
+    check(movies.size() == 4 && movies[0].title == "First", "nested title doesn't overwrite the movie's");
+    check(movies.size() == 4 && movies[1].release_date == "No release date" && movies[2].release_date == "No release date",
+          "empty and null release dates are No release date");
+    check(movies.size() == 4 && movies[3].title == "Unknown title", "missing title is Unknown title");
+
+    vector<Movie> topBilled;
+    size_t dropped = 0;
+    check(parseFilmography(personCredits, topBilled, error, nullptr, castPolicy(10, true, true), &dropped),
+          "person credits parse with a policy");
+    check(sameMovies(topBilled, domFilmography(json::parse(personCredits), castPolicy(10, true, true))),
+          "filmography with a policy matches the document parsing");
+    check(topBilled.size() == 2 && topBilled[0].id == 10 && topBilled[1].id == 13 && dropped == 2,
+          "policy keeps the top billed on screen role and the entry without a billing position");
+}
+
+//a /person/{id}?append_to_response=movie_credits response: the person is at the top level, the cast under
+//movie_credits (its own id and the top level cast key must not be used)
+const string personWithCredits = R"json({
+    "id": 31,
+    "name": "Tom Hanks",
+    "profile_path": null,
+    "also_known_as": ["Thomas Hanks"],
+    "cast": [{"id": 80, "title": "Top Level Cast"}],
+    "movie_credits": {
+        "id": 32,
+        "name": "Not The Person",
+        "cast": [
+            {"id": 10, "title": "First", "release_date": "1994-07-06", "poster_path": "/first.jpg", "order": 0},
+            {"id": 11, "title": "Second", "release_date": "1995-11-22", "order": 1, "character": "Woody (voice)"}
+        ],
+        "crew": [{"id": 70, "title": "Directed"}]
+    }
+})json";
+
+void testFilmographyWithPerson() {
+    vector<Movie> movies;
+    string error;
+    Actor person(0, "Placeholder", "/old.jpg");
+    check(parseFilmography(personWithCredits, movies, error, &person), "person response parses");
+
+    json data = json::parse(personWithCredits);
+    check(sameMovies(movies, domFilmography(data["movie_credits"])), "movies match the document parsing");
+    check(person.id == data["id"].get<int>() && person.name == data["name"].get<string>(), "person id and name");
+    check(person.profile_path.empty(), "null person profile_path is empty");
+
+    vector<Movie> onScreen;
+    size_t dropped = 0;
+    Actor again;
+    check(parseFilmography(personWithCredits, onScreen, error, &again, castPolicy(-1, false, true), &dropped),
+          "person response parses with a policy");
+    check(sameMovies(onScreen, domFilmography(data["movie_credits"], castPolicy(-1, false, true))) && dropped == 1,
+          "voice role dropped from the person's movies");
+    check(again.id == 31, "policy doesn't change the person record");
+}
+
+//a /movie/{id}?append_to_response=credits response (bulk import)
+const string movieWithCredits = R"json({
+    "id": 13,
+    "title": "Forrest Gump",
+    "release_date": "1994-07-06",
+    "poster_path": null,
+    "genres": [{"id": 18, "name": "Drama"}],
+    "belongs_to_collection": {"id": 5, "title": "Not The Movie", "poster_path": "/collection.jpg"},
+    "cast": [{"id": 80, "name": "Top Level Cast"}],
+    "credits": {
+        "id": 14,
+        "cast": [
+            {"id": 31, "name": "Tom Hanks", "profile_path": "/hanks.jpg", "order": 0, "character": "Forrest Gump"},
+            {"id": 32, "name": "Robin Wright", "profile_path": null, "order": 1},
+            {"id": 33, "name": "Extra", "order": 40, "character": "Reporter (uncredited)"}
+        ],
+        "crew": [{"id": 24, "name": "Robert Zemeckis", "job": "Director"}]
+    }
+})json";
+
+void testMovieCredits() {
+    Movie movie(0, "Unknown title", "", "/old.jpg");
+    vector<Actor> cast;
+    string error;
+    check(parseMovieCredits(movieWithCredits, movie, cast, error), "movie with credits parses");
+
+    json data = json::parse(movieWithCredits);
+    check(sameCast(cast, domCast(data["credits"])), "cast matches the document parsing");
+    check(movie.id == 13 && movie.title == "Forrest Gump" && movie.release_date == "1994-07-06",
+          "movie record from the top level fields only");
+    check(movie.poster_path.empty(), "null poster_path is empty");
+
+    Movie again(0, "", "", "");
+    vector<Actor> credited;
+    size_t dropped = 0;
+    check(parseMovieCredits(movieWithCredits, again, credited, error, castPolicy(2, true, false), &dropped),
+          "movie with credits parses with a policy");
+    check(sameCast(credited, domCast(data["credits"], castPolicy(2, true, false))) && dropped == 1,
+          "extra dropped from the imported cast");
+}
+
+int main() {
+    testCast();
+    testFilmography();
+    testFilmographyWithPerson();
+    testMovieCredits();
+
+    if (failures > 0) {
+        cout << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "All credits checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef EDGEINDEX_H
+#define EDGEINDEX_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+using namespace std;
+
+//hash index of the graph's (undirected) edges: {a, b} -> where the edge sits in a's and in b's adjacency list
+//open addressing with linear probing in one flat array -> no allocation per edge, and a lookup usually touches
+//a single cache line no matter how many connections a or b have
+class edgeIndex {
+private:
+    struct slot {
+        uint64_t key; //smaller vertex << 32 | bigger vertex, 0 marks an empty slot (edges never join a vertex to itself)
+        uint32_t lowPosition; //position of the edge in the smaller vertex's list
+        uint32_t highPosition; //and in the bigger vertex's list
+    };
+
+    vector<slot> slots; //size is a power of two
+    size_t count;
+
+    static uint64_t makeKey(int a, int b) {
+        uint64_t low = static_cast<uint32_t>(a < b ? a : b);
+        uint64_t high = static_cast<uint32_t>(a < b ? b : a);
+        return low << 32 | high;
+    }
+
+    //splitmix64 finalizer: vertex numbers are dense, so the raw key would put neighbours next to each other
+    static size_t hash(uint64_t key) {
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return static_cast<size_t>(key);
+    }
+
+    //slot holding key, or the empty slot where it would go
+    size_t probe(uint64_t key) const {
+        size_t mask = slots.size() - 1;
+        size_t i = hash(key) & mask;
+        while (slots[i].key != 0 && slots[i].key != key) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void grow() {
+        vector<slot> old = move(slots);
+        slots.assign(old.empty() ? 1024 : old.size() * 2, slot{0, 0, 0});
+        for (const slot& entry : old) {
+            if (entry.key != 0) {
+                slots[probe(entry.key)] = entry;
+            }
+        }
+    }
+
+public:
+    edgeIndex() : count(0) {}
+
+    //looks up edge {a, b}: returns false if it is not indexed, otherwise its positions in a's and b's lists
+    bool find(int a, int b, size_t& positionA, size_t& positionB) const {
+        if (slots.empty()) {
+            return false;
+        }
+        const slot& entry = slots[probe(makeKey(a, b))];
+        if (entry.key == 0) {
+            return false;
+        }
+        positionA = a < b ? entry.lowPosition : entry.highPosition;
+        positionB = a < b ? entry.highPosition : entry.lowPosition;
+        return true;
+    }
+
+    //indexes edge {a, b} at the given positions (nothing happens if it is indexed already)
+    void add(int a, int b, size_t positionA, size_t positionB) {
+        if ((count + 1) * 4 > slots.size() * 3) { //keep the load under 75%
+            grow();
+        }
+        uint64_t key = makeKey(a, b);
+        slot& entry = slots[probe(key)];
+        if (entry.key == key) {
+            return;
+        }
+        entry.key = key;
+        entry.lowPosition = static_cast<uint32_t>(a < b ? positionA : positionB);
+        entry.highPosition = static_cast<uint32_t>(a < b ? positionB : positionA);
+        count++;
+    }
+
+    size_t size() const { return count; }
+};
+
+#endif //EDGEINDEX_H
@@ -1,66 +1,86 @@
 #include "graph.h"
 
-void Graph::addNode(Actor* actor) {
+int Graph::addNode(Actor* actor) {
     graphLog << actor->name << " was added to graph." << endl;
-    actors[actor->id] = actor;
-    adjacencyList[actor->id] = vector<Connection>();
+    int vertex = static_cast<int>(actors.size());
+    vertexOf[actor->id] = vertex;
+    actors.push_back(actor);
+    addVertexList();
+    snapshotStale = true;
+    return vertex;
 }
 
-void Graph::findSharedMovie(Actor *actor, int targetActorID) {
-    graphLog << "Fetching movies for " << actor->name << " to find connection to actor ID " << targetActorID << endl;
-    vector<Movie> moviesArray = API.getMovies(actor->name);
-
-    if(moviesArray.empty()) {
-        graphLog << "ERROR: No movies found for " <<actor->name << endl;
+void Graph::setBipartite(bool enabled) {
+    if (!actors.empty() || !movies.empty()) {
+        graphLog << "ERROR: Graph mode can only be changed while the graph is empty" << endl;
         return;
     }
+    bipartite = enabled;
+    snapshotStale = true;
+}
 
-    bool found = false;
-    vector<Actor> cast;
+void Graph::findSharedMovie(Actor *actor, int targetActorID) {
+    graphLog << "Fetching movies for " << actor->name << " and actor ID " << targetActorID << " to find a connection" << endl;
+
+    //both filmographies are fetched at the same time -> two requests in total
+    //(the target's person record comes in the same response, in case it still has to be added to the graph)
+    Actor targetPerson;
+    future<vector<Movie>> targetRequest = async(launch::async, [&]() {
+        return API.getMoviesByActorId(targetActorID, targetPerson);
+    });
+    vector<Movie> moviesArray = API.getMoviesByActorId(actor->id);
+    vector<Movie> targetMovies = targetRequest.get();
+
+    if(moviesArray.empty() || targetMovies.empty()) {
+        graphLog << "ERROR: No movies found for " << (moviesArray.empty() ? actor->name : "actor ID " + to_string(targetActorID)) << endl;
+        return;
+    }
 
+    //intersect the two filmographies by movie id
+    unordered_set<int> movieIds;
     for(auto& movie : moviesArray) {
-        graphLog << "Checking movie: " << movie.title << " for connections" << endl;
-        cast = API.getActors(movie.title);
+        movieIds.insert(movie.id);
+    }
 
-        if(cast.empty()) {
-            graphLog << "ERROR: No cast found for movie: " << movie.title << endl;
-            continue;
+    for(auto& movie : targetMovies) {
+        if(movieIds.erase(movie.id) == 0) {
+            continue; //not shared (or already connected through this movie)
         }
 
-        for(auto& person : cast) {
-            if(person.id == targetActorID) {
-                graphLog << "Found connection: " << actor->name << " and actor ID " << person.id
-                             << " in movie \"" << movie.title << "\"" << endl;
+        graphLog << "Found connection: " << actor->name << " and actor ID " << targetActorID
+                     << " in movie \"" << movie.title << "\"" << endl;
 
-                Movie* moviePtr = addMovie(movie.id, movie.title, movie.release_date, movie.poster_path);
+        Movie* moviePtr = addMovie(movie.id, movie.title, movie.release_date, movie.poster_path);
 
-                //add target actor if not already in graph
-                if(actors.find(person.id) == actors.end()) {
-                    Actor* targetActor = new Actor(person.id, person.name, person.profile_path);
-                    addNode(targetActor);
-                }
+        //add target actor if not already in graph
+        int targetVertex = findVertex(targetActorID);
+        if(targetVertex < 0) {
+            Actor* targetActor = actorArena.create(targetActorID, move(targetPerson.name), move(targetPerson.profile_path));
+            targetVertex = addNode(targetActor);
+        }
 
-                //add connection
-                addConnection(actor->id, person.id, moviePtr);
-                found = true;
-                break; //found a connection -> no need to check other actors in this movie
-            }
+        //add connection (every shared movie ends up in the same Connection)
+        if (bipartite) {
+            linkCast(moviePtr, {findVertex(actor->id), targetVertex});
+        } else {
+            addConnection(findVertex(actor->id), targetVertex, moviePtr);
         }
-        if(found) break; //found a connection -> no need to check other movies
     }
 }
 
 void Graph::addActor(Actor* actor, int targetActorID) {
     //in case of duplicates, deletes actor and returns
-    if(actors.find(actor->id) != actors.end()) {
+    if(findVertex(actor->id) >= 0) {
         delete actor;
         return;
     }
 
-    addNode(actor);
+    Actor* stored = actorArena.create(move(*actor));
+    delete actor;
+    addNode(stored);
 
     if(targetActorID > 0) {
-        findSharedMovie(actor, targetActorID);
+        findSharedMovie(stored, targetActorID);
     }
 
 }
@@ -73,79 +93,217 @@ Movie* Graph::addMovie(int id, const string& title, const string& release_date,
     }
 
     //else create and add new movie
-    Movie* movie = new Movie(id, title, release_date, poster_path);
+    Movie* movie = movieArena.create(id, title, release_date, poster_path);
     movies[id] = movie;
     return movie;
 }
 
-bool Graph::addConnection(int actorId1, int actorId2, Movie* movie) {
-    if (adjacencyList.find(actorId1) == adjacencyList.end() ||
-        adjacencyList.find(actorId2) == adjacencyList.end()) {
-        return false; //one or both actors not found in the graph
+void Graph::addCast(const Movie& movie, vector<Actor>& cast) {
+    if (cast.empty()) {
+        return;
+    }
+    Movie* moviePtr = addMovie(movie.id, movie.title, movie.release_date, movie.poster_path);
+    snapshotStale = true;
+
+    //no log line per actor here, an import adds millions of them
+    vector<int> castVertices;
+    castVertices.reserve(cast.size());
+    for (auto& person : cast) {
+        int vertex = findVertex(person.id);
+        if (vertex < 0) {
+            vertex = static_cast<int>(actors.size());
+            vertexOf[person.id] = vertex;
+            actors.push_back(actorArena.create(person.id, move(person.name), move(person.profile_path)));
+            addVertexList();
+        }
+        castVertices.push_back(vertex);
+    }
+
+    if (bipartite) {
+        linkCast(moviePtr, castVertices);
+        return;
+    }
+    for (size_t i = 0; i < castVertices.size(); i++) {
+        for (size_t j = i + 1; j < castVertices.size(); j++) {
+            if (castVertices[i] != castVertices[j]) { //same person in two roles
+                addConnection(castVertices[i], castVertices[j], moviePtr);
+            }
+        }
     }
+}
 
-    //add connection from actorId1 to actorId2
-    auto& connections1 = adjacencyList[actorId1];
-    bool found1 = false;
+Actor* Graph::findActorByName(const string& name) const {
+    //several people can share a name -> the best connected one (like the api's search, which ranks by popularity)
+    Actor* best = nullptr;
+    size_t bestDegree = 0;
+    for (size_t vertex = 0; vertex < actors.size(); vertex++) {
+        if (actors[vertex]->name != name) {
+            continue;
+        }
+        size_t connections = degree(static_cast<int>(vertex));
+        if (best == nullptr || connections > bestDegree || (connections == bestDegree && actors[vertex]->id < best->id)) {
+            best = actors[vertex];
+            bestDegree = connections;
+        }
+    }
+    return best;
+}
 
-    for (auto& connections : connections1) {
-        if (connections.actorId == actorId2) {
-            bool movieExists = false;
-            for (const auto& m : connections.movies) {
-                if (m->id == movie->id) {
-                    movieExists = true;
+bool Graph::addConnection(int vertex1, int vertex2, Movie* movie) {
+    //(adjacencyList is empty in bipartite mode -> never connects there)
+    if (vertex1 < 0 || vertex2 < 0 || vertex1 >= static_cast<int>(adjacencyList.size()) || vertex2 >= static_cast<int>(adjacencyList.size())) {
+        return false; //one or both actors not found in the graph
+    }
+    if (vertex1 == vertex2) {
+        return false; //self-connection
+    }
+    snapshotStale = true;
+
+    auto& connections1 = adjacencyList[vertex1];
+    auto& connections2 = adjacencyList[vertex2];
+
+    //find the existing connection in both lists: through the index if either actor has a long list
+    //(all of its connections are indexed), otherwise both lists are short and a scan is cheapest
+    Connection* existing1 = nullptr;
+    Connection* existing2 = nullptr;
+    if (connections1.size() >= indexThreshold || connections2.size() >= indexThreshold) {
+        size_t position1 = 0;
+        size_t position2 = 0;
+        if (edges.find(vertex1, vertex2, position1, position2)) {
+            existing1 = &connections1[position1];
+            existing2 = &connections2[position2];
+        }
+    } else {
+        for (auto& connection : connections1) {
+            if (connection.vertex == vertex2) {
+                existing1 = &connection;
+                break;
+            }
+        }
+        if (existing1 != nullptr) {
+            for (auto& connection : connections2) {
+                if (connection.vertex == vertex1) {
+                    existing2 = &connection;
                     break;
                 }
             }
-
-            if (!movieExists) {
-                connections.movies.push_back(movie);
-            }
-
-            found1 = true;
-            break;
         }
     }
 
-    //connection not found -> create new one
-    if (!found1) {
-        Connection newConn(actorId2);
-        newConn.movies.push_back(movie);
-        connections1.push_back(newConn);
+    //connection already exists -> only the movie may be new
+    //(both directions hold the same movies, which are only the few films the two made together)
+    if (existing1 != nullptr) {
+        if (find(existing1->movies.begin(), existing1->movies.end(), movie) == existing1->movies.end()) {
+            existing1->movies.push_back(movie);
+            existing2->movies.push_back(movie);
+        }
+        return true;
     }
 
-    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    //connection not found -> create new one in both directions
+    connections1.emplace_back(vertex2);
+    connections1.back().movies.push_back(movie);
+    connections2.emplace_back(vertex1);
+    connections2.back().movies.push_back(movie);
 
-    //add connection from actorId1 to actorId2 (same thing as before but reversed)
-    auto& connections2 = adjacencyList[actorId2];
-    bool found2 = false;
+    //an actor reaching the threshold gets all of its connections indexed, after that each new one is added
+    //(>= : if both reach it with this connection, indexVertex skips it on both sides, so it is added here)
+    if (connections1.size() == indexThreshold) {
+        indexVertex(vertex1);
+    }
+    if (connections2.size() == indexThreshold) {
+        indexVertex(vertex2);
+    }
+    if (connections1.size() >= indexThreshold || connections2.size() >= indexThreshold) {
+        edges.add(vertex1, vertex2, connections1.size() - 1, connections2.size() - 1);
+    }
+    return true; //actors were connected
+}
 
-    for (auto& conn : connections2) {
-        if (conn.actorId == actorId1) {
-            bool movieExists = false;
-            for (const auto& m : conn.movies) {
-                if (m->id == movie->id) {
-                    movieExists = true;
-                    break;
-                }
+void Graph::indexVertex(int vertex) {
+    const auto& connections = adjacencyList[vertex];
+    for (size_t position = 0; position < connections.size(); position++) {
+        int other = connections[position].vertex;
+        const auto& otherConnections = adjacencyList[other];
+        if (otherConnections.size() >= indexThreshold) {
+            continue; //already indexed along with the other actor
+        }
+        //the other list is short, so finding this connection in it is a short scan
+        for (size_t otherPosition = 0; otherPosition < otherConnections.size(); otherPosition++) {
+            if (otherConnections[otherPosition].vertex == vertex) {
+                edges.add(vertex, other, position, otherPosition);
+                break;
             }
+        }
+    }
+}
 
-            if (!movieExists) {
-                conn.movies.push_back(movie);
-            }
+int Graph::linkCast(Movie* movie, const vector<int>& castVertices) {
+    int movieVertex;
+    auto it = movieVertexOf.find(movie->id);
+    if (it != movieVertexOf.end()) {
+        movieVertex = it->second;
+    } else {
+        movieVertex = static_cast<int>(movieVertices.size());
+        movieVertexOf[movie->id] = movieVertex;
+        movieVertices.push_back(movie);
+        movieCasts.emplace_back();
+    }
+    snapshotStale = true;
 
-            found2 = true;
-            break;
+    //stamp who is already in the cast -> each actor is checked in O(1) instead of scanning the cast
+    castStamp.resize(actors.size(), -1);
+    auto& cast = movieCasts[movieVertex];
+    for (int vertex : cast) {
+        castStamp[vertex] = movieVertex;
+    }
+
+    int linksAdded = 0;
+    for (int vertex : castVertices) {
+        if (vertex < 0 || vertex >= static_cast<int>(actorMovies.size()) || castStamp[vertex] == movieVertex) {
+            continue; //not in the graph, already linked or the same person in two roles
         }
+        castStamp[vertex] = movieVertex;
+        cast.push_back(vertex);
+        actorMovies[vertex].push_back(movieVertex);
+        linksAdded++;
     }
+    return linksAdded;
+}
 
-    //connection not found -> create new one
-    if (!found2) {
-        Connection newConn(actorId1);
-        newConn.movies.push_back(movie);
-        connections2.push_back(newConn);
+template <typename Visit>
+void Graph::forEachNewNeighbour(int current, searchState& side, long long& edges, Visit visit) {
+    if (!bipartite) {
+        for (size_t edge = snapshot.offsets[current]; edge < snapshot.offsets[current + 1]; edge++) {
+            int neighbor = snapshot.neighbours[edge];
+            edges++;
+            if (!side.visited[neighbor] && visit(neighbor, snapshot.edgeMovies[edge])) {
+                return;
+            }
+        }
+        return;
+    }
+
+    //actor -> its movies -> their casts, in the order they were linked, which visits co-stars in the same order
+    //(and through the same first shared movie) as the clique's adjacency list
+    //a movie's cast only has to be scanned once per search: after that all of it is visited
+    for (size_t link = snapshot.offsets[current]; link < snapshot.offsets[current + 1]; link++) {
+        int movieVertex = snapshot.neighbours[link];
+        edges++;
+        if (side.movieVisited[movieVertex]) {
+            continue;
+        }
+        side.visitMovie(movieVertex);
+
+        Movie* movie = movieVertices[movieVertex];
+        for (size_t member = castSnapshot.offsets[movieVertex]; member < castSnapshot.offsets[movieVertex + 1]; member++) {
+            int neighbor = castSnapshot.neighbours[member];
+            edges++;
+            if (!side.visited[neighbor] && visit(neighbor, movie)) {
+                return;
+            }
+        }
     }
-    return true; //actors were connected
 }
 
 SearchResult Graph::findPathBFS(int startActorId, int endActorId) {
@@ -158,8 +316,8 @@ SearchResult Graph::findPathBFS(int startActorId, int endActorId) {
     graphLog << "BFS from actor " << startActorId << " to " << endActorId << ":\n" <<endl;
 
     if(startActorId == endActorId) { //trying to connect an actor to themselves
-        if (actors.find(startActorId) != actors.end()) {
-            result.path.push_back(PathStep(actors[startActorId]));
+        if (getActor(startActorId) != nullptr) {
+            result.path.push_back(PathStep(getActor(startActorId)));
             result.visited = 1;
         }
         auto end_time = chrono::high_resolution_clock::now();
@@ -171,12 +329,13 @@ SearchResult Graph::findPathBFS(int startActorId, int endActorId) {
 
     //step 1: fetch data in case start actor has no edges yet
 
-    if (adjacencyList[startActorId].empty()) {
+    int startVertexId = findVertex(startActorId);
+    if (expandOnDemand && (startVertexId < 0 || degree(startVertexId) == 0)) {
         graphLog << "BFS: No existing connections for actor " << startActorId << ". ";
         set<int> dummySet;
         expandFromActor(startActorId, dummySet);
-    } else {
-        graphLog << "BFS: Found " << adjacencyList[startActorId].size() << " existing connections for start actor." << endl;
+    } else if (startVertexId >= 0) {
+        graphLog << "BFS: Found " << degree(startVertexId) << " existing connections for start actor." << endl;
     }
 
 
@@ -184,42 +343,47 @@ SearchResult Graph::findPathBFS(int startActorId, int endActorId) {
 
     //step 2: algorithm
 
+    const csrGraph& csr = frozen(); //built before the timer starts, like the data fetching above
     auto algorithm_start = chrono::high_resolution_clock::now();
 
-    unordered_map<int, pair<int, Movie*>> previous; //to keep track of how we got to each actor -> stores (parent.id, edge)
-    unordered_set<int> visited;
+    //TMDB ids are translated once, everything below works on vertices
+    startVertexId = findVertex(startActorId);
+    int endVertexId = findVertex(endActorId);
+    if (startVertexId < 0 || endVertexId < 0) {
+        graphLog << "BFS: No path found between actors." << endl;
+        return result;
+    }
+
+    //keeps track of how we got to each actor -> (parent vertex, edge)
+    searchState& state = forward;
+    state.reset(csr.vertexCount(), castSnapshot.vertexCount());
     queue<int> q;
-    q.push(startActorId);
-    visited.insert(startActorId);
+    q.push(startVertexId);
+    state.visit(startVertexId, -1, nullptr);
+    result.visited = 1;
     bool found = false;
 
     while (!q.empty() && !found) {
-        int currentId = q.front();
+        int current = q.front();
         q.pop();
 
-        graphLog << "BFS: Visiting actor " << currentId << " (" << actors[currentId]->name << ")" << endl;
-
-        const auto& connections = adjacencyList[currentId];
-
-        //explore neighbors
-        for(const auto& connection : connections) {
-            int neighborId = connection.actorId;
-
-            if(visited.find(neighborId) == visited.end()) { //neighbor hasn't been visited yet
-                graphLog << "BFS: Visiting neighbor " << neighborId  << " (" << actors[neighborId]->name << ")" << endl;
+        //'\n' instead of endl: flushing the log for every vertex costs more than the search itself
+        graphLog << "BFS: Visiting actor " << actors[current]->id << " (" << actors[current]->name << ")" << '\n';
 
-                visited.insert(neighborId);
-                q.push(neighborId);
+        //explore neighbors that haven't been visited yet
+        forEachNewNeighbour(current, state, result.edges, [&](int neighbor, Movie* movie) {
+            graphLog << "BFS: Visiting neighbor " << actors[neighbor]->id << " (" << actors[neighbor]->name << ")" << '\n';
 
-                previous[neighborId] = make_pair(currentId, connection.movies[0]);
+            state.visit(neighbor, current, movie);
+            result.visited++;
+            q.push(neighbor);
 
-                if(neighborId == endActorId) {
-                    graphLog << "BFS: Found target actor! Search complete." << endl;
-                    found = true;
-                    break;
-                }
+            if(neighbor == endVertexId) {
+                graphLog << "BFS: Found target actor! Search complete." << endl;
+                found = true;
             }
-        }
+            return found;
+        });
     }
 
     auto end_time = chrono::high_resolution_clock::now(); //end timer
@@ -233,54 +397,55 @@ SearchResult Graph::findPathBFS(int startActorId, int endActorId) {
 
     //reconstruct path to add to SearchResult
     vector<PathStep> reversedPath;
-    int current = endActorId;
+    int current = endVertexId;
 
-    while(current != startActorId) {
-        auto [prev, movie] = previous[current];
-        reversedPath.push_back(PathStep(actors[current], actors[prev], movie));
+    while(current != startVertexId) {
+        int prev = state.previous[current];
+        reversedPath.push_back(PathStep(actors[current], actors[prev], state.previousMovie[current]));
         current = prev;
     }
-    reversedPath.push_back(PathStep(actors[startActorId])); //add start actor to path
+    reversedPath.push_back(PathStep(actors[startVertexId])); //add start actor to path
 
     //reverse and add to result
     for (auto it = reversedPath.rbegin(); it != reversedPath.rend(); ++it) {
         result.path.push_back(*it);
     }
 
-    result.visited = visited.size();
-
     graphLog << "BFS complete! Path length: " << result.path.size() << endl;
     return result;
 }
 
 void Graph::expandFromActor(int actorId, set<int>& targetSet) {
 
-    if (actors.find(actorId) == actors.end()) {
+    int actorVertex = findVertex(actorId);
+    if (actorVertex < 0) {
         return; //actor is not on graph
     }
 
-    Actor* actor = actors[actorId];
+    Actor* actor = actors[actorVertex];
     graphLog << "Expanding graph from actor: " << actor->name << endl;
 
     //fetch movies for that actor
-    vector<Movie> movies = API.getMovies(actor->name);
+    vector<Movie> movies = API.getMoviesByActorId(actor->id);
     if (movies.empty()) {
         graphLog << "ERROR: No movies found for " << actor->name << " during graph expansion" << endl;
         return;
     }
 
     int connectionsAdded = 0;
+    vector<int> castVertices; //bipartite mode: the actor and everyone in the movie
 
-    //fetch cast for each movie actor is in
-    for (auto& movie : movies) {
-        vector<Actor> cast = API.getActors(movie.title);
-
+    //fetch cast for each movie actor is in (requests run concurrently, merging happens here)
+    fetchCasts(movies, [&](size_t index, vector<Actor>& cast) {
         if (cast.empty()) {
-            continue; //no cast data to work with
+            return; //no cast data to work with
         }
 
+        const Movie& movie = movies[index];
+
         //creates or finds movie object in graph
         Movie* moviePtr = addMovie(movie.id, movie.title, movie.release_date, movie.poster_path);
+        castVertices.assign(1, actorVertex);
 
         //go through each person in the cast
         for (auto& person : cast) {
@@ -289,59 +454,243 @@ void Graph::expandFromActor(int actorId, set<int>& targetSet) {
             }
 
             //add new actor, if not in the graph already
-            if (actors.find(person.id) == actors.end()) {
-                Actor* newActor = new Actor(person.id, person.name, person.profile_path);
-                addNode(newActor);
+            //(the parsed entry's strings are moved into the arena record, no second copy)
+            int personVertex = findVertex(person.id);
+            if (personVertex < 0) {
+                Actor* newActor = actorArena.create(person.id, move(person.name), move(person.profile_path));
+                personVertex = addNode(newActor);
 
                 //add to target set for bidirectional search
                 targetSet.insert(person.id);
             }
 
             //adds connection
-            if (addConnection(actorId, person.id, moviePtr)) {
+            if (bipartite) {
+                castVertices.push_back(personVertex);
+            } else if (addConnection(actorVertex, personVertex, moviePtr)) {
                 connectionsAdded++;
-                graphLog << actor->name << " and " << person.name << " connected.";
+                graphLog << actor->name << " and " << actors[personVertex]->name << " connected.";
             }
 
         }
-    }
+
+        if (bipartite) {
+            connectionsAdded += linkCast(moviePtr, castVertices);
+        }
+    });
 
     graphLog << connectionsAdded << " connections added from " << actor->name << endl;
 }
 
+void Graph::fetchCasts(const vector<Movie>& movies, const function<void(size_t, vector<Actor>&)>& onCast) {
+    if (movies.empty()) {
+        return;
+    }
+    if (asyncFetching) {
+        fetchCastsAsync(movies, onCast);
+        return;
+    }
+
+    //one slot per movie, filled by the workers
+    vector<optional<vector<Actor>>> casts(movies.size());
+    mutex castsMutex;
+    condition_variable castArrived;
+    atomic<size_t> nextMovie(0);
+
+    //each worker keeps taking the next movie that nobody has requested yet
+    auto worker = [&]() {
+        while (true) {
+            size_t index = nextMovie++;
+            if (index >= movies.size()) {
+                break;
+            }
+
+            vector<Actor> cast = API.getCastByMovieId(movies[index].id);
+
+            {
+                lock_guard<mutex> lock(castsMutex);
+                casts[index] = move(cast);
+            }
+            castArrived.notify_one();
+        }
+    };
+
+    size_t workerCount = min(static_cast<size_t>(fetchConcurrency), movies.size());
+    vector<thread> workers;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(worker);
+    }
+
+    //merge casts in movie order while the remaining requests are still running
+    for (size_t index = 0; index < movies.size(); index++) {
+        vector<Actor> cast;
+        {
+            unique_lock<mutex> lock(castsMutex);
+            castArrived.wait(lock, [&] { return casts[index].has_value(); });
+            cast = move(*casts[index]);
+        }
+        onCast(index, cast);
+    }
+
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+void Graph::fetchCastsAsync(const vector<Movie>& movies, const function<void(size_t, vector<Actor>&)>& onCast) {
+    eventLoop loop(API.client()); //same connections as the blocking requests
+
+    vector<optional<vector<Actor>>> casts(movies.size());
+    size_t nextMovie = 0;
+    size_t nextMerge = 0;
+
+    //each coroutine keeps taking the next movie; whoever fills the next slot in order merges everything ready
+    auto worker = [&]() -> task<void> {
+        while (nextMovie < movies.size()) {
+            size_t index = nextMovie++;
+            casts[index] = co_await API.getCastByMovieIdAsync(loop, movies[index].id);
+
+            while (nextMerge < movies.size() && casts[nextMerge].has_value()) {
+                onCast(nextMerge, *casts[nextMerge]);
+                casts[nextMerge].reset();
+                nextMerge++;
+            }
+        }
+    };
+
+    size_t workerCount = min(static_cast<size_t>(fetchConcurrency), movies.size());
+    vector<task<void>> workers;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.push_back(worker());
+    }
+    loop.runAll(workers);
+}
+
 pair<int, int> Graph::getStats() const {
     int connectionCount = 0;
 
-    for (const auto& pair : adjacencyList) {
-        connectionCount += pair.second.size();
+    //only the structure of the graph's mode is filled
+    if (bipartite) {
+        for (const auto& links : actorMovies) {
+            connectionCount += links.size();
+        }
+        return make_pair(actors.size(), connectionCount);
+    }
+
+    for (const auto& connections : adjacencyList) {
+        connectionCount += connections.size();
     }
 
     //divide by 2 because it's bidirectional
     return make_pair(actors.size(), connectionCount / 2);
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+graphAllocStats Graph::getAllocStats() const {
+    graphAllocStats stats;
+    stats.actors = static_cast<long long>(actorArena.size());
+    stats.movies = static_cast<long long>(movieArena.size());
+    stats.slabs = static_cast<long long>(actorArena.blockCount() + movieArena.blockCount());
+    return stats;
+}
 
-//Helper method for bidirectional search to process neighbors and find meeting points
-bool Graph::processNeighbors(int currentActorId, unordered_map<int, pair<int, Movie*>>& previous, set<int> &visited, queue<int> &q, set<int> &otherVisited, int &meetingPoint) {
-    const auto& connections = adjacencyList[currentActorId];
-    //For every actor in the adjacency list for the current actor:
-    for(const auto& connection : connections) {
-        int neighboringActorId = connection.actorId;
-        //Check if they are in the visited set, if not then add them and check to see if we find a meeting point:
-        if(visited.find(neighboringActorId) == visited.end()) {
-            visited.insert(neighboringActorId);
-            q.push(neighboringActorId);
-            previous[neighboringActorId] = make_pair(currentActorId, connection.movies[0]);
-            //If they are in otherVisited then we found a meeting point:
-            if(otherVisited.find(neighboringActorId) != otherVisited.end()) {
-                meetingPoint = neighboringActorId;
-                return true;
+const csrGraph& Graph::frozen() {
+    if (!snapshotStale) {
+        return snapshot;
+    }
+
+    if (bipartite) {
+        //actor -> movies and movie -> cast, both in link order
+        auto freeze = [](const vector<vector<int>>& lists, csrGraph& csr) {
+            size_t linkCount = 0;
+            for (const auto& list : lists) {
+                linkCount += list.size();
             }
+            csr = csrGraph();
+            csr.offsets.reserve(lists.size() + 1);
+            csr.neighbours.reserve(linkCount);
+            csr.offsets.push_back(0);
+            for (const auto& list : lists) {
+                csr.neighbours.insert(csr.neighbours.end(), list.begin(), list.end());
+                csr.offsets.push_back(csr.neighbours.size());
+            }
+        };
+        freeze(actorMovies, snapshot);
+        freeze(movieCasts, castSnapshot);
+        snapshotStale = false;
+        forward.reset(snapshot.vertexCount(), castSnapshot.vertexCount());
+        backward.reset(snapshot.vertexCount(), castSnapshot.vertexCount());
+        return snapshot;
+    }
+
+    csrGraph csr;
+    size_t edgeCount = 0;
+    for (const auto& connections : adjacencyList) {
+        edgeCount += connections.size();
+    }
+
+    //rows keep the adjacency list order, so searches visit neighbours (and find paths) exactly as before
+    csr.offsets.reserve(adjacencyList.size() + 1);
+    csr.neighbours.reserve(edgeCount);
+    csr.edgeMovies.reserve(edgeCount);
+    csr.offsets.push_back(0);
+    for (const auto& connections : adjacencyList) {
+        for (const auto& connection : connections) {
+            csr.neighbours.push_back(connection.vertex);
+            csr.edgeMovies.push_back(connection.movies[0]);
         }
+        csr.offsets.push_back(csr.neighbours.size());
     }
+
+    snapshot = move(csr);
+    snapshotStale = false;
+    forward.reset(snapshot.vertexCount());
+    backward.reset(snapshot.vertexCount());
+    return snapshot;
+}
+
+void searchState::reset(int n, int movieCount) {
+    if (visited.size() != static_cast<size_t>(n) || movieVisited.size() != static_cast<size_t>(movieCount)) {
+        visited.assign(n, 0);
+        previous.assign(n, -1);
+        previousMovie.assign(n, nullptr);
+        movieVisited.assign(movieCount, 0);
+        touched.clear();
+        touchedMovies.clear();
+        return;
+    }
+    for (int vertex : touched) {
+        visited[vertex] = 0;
+        previous[vertex] = -1;
+        previousMovie[vertex] = nullptr;
+    }
+    for (int movieVertex : touchedMovies) {
+        movieVisited[movieVertex] = 0;
+    }
+    touched.clear();
+    touchedMovies.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Helper method for bidirectional search to process neighbors and find meeting points
+bool Graph::processNeighbors(int current, searchState& side, queue<int>& q, const searchState& otherSide,
+                             int& meetingPoint, int& visitedCount, long long& edges) {
+    //For every neighbour of the current actor that this side hasn't visited, add them and check to see if we find a meeting point:
+    bool met = false;
+    forEachNewNeighbour(current, side, edges, [&](int neighbor, Movie* movie) {
+        side.visit(neighbor, current, movie);
+        q.push(neighbor);
+        //If the other side visited them then we found a meeting point:
+        if(otherSide.visited[neighbor]) {
+            meetingPoint = neighbor;
+            met = true;
+            return true;
+        }
+        visitedCount++;
+        return false;
+    });
     //If we do not find a meeting point, return false
-    return false;
+    return met;
 }
 
 //Bidirectional Search (BDS)
@@ -349,48 +698,56 @@ SearchResult Graph::findPathBDS(int startActorId, int endActorId) {
     SearchResult result;
 
     if(startActorId == endActorId) {
-        if(actors.find(startActorId) != actors.end()) {
-            result.path.push_back(PathStep(actors[startActorId]));
+        if(getActor(startActorId) != nullptr) {
+            result.path.push_back(PathStep(getActor(startActorId)));
             result.visited = 1;
         }
         return result;
     }
 
-    if(adjacencyList[startActorId].empty()) {
+    int startVertexId = findVertex(startActorId);
+    if(expandOnDemand && (startVertexId < 0 || degree(startVertexId) == 0)) {
         set<int> expansionSet;
         expandFromActor(startActorId, expansionSet);
     }
-    if(adjacencyList[endActorId].empty()) {
+    int endVertexId = findVertex(endActorId);
+    if(expandOnDemand && (endVertexId < 0 || degree(endVertexId) == 0)) {
         set<int> expansionSet;
         expandFromActor(endActorId, expansionSet);
     }
 
+    //TMDB ids are translated once, everything below works on vertices
+    const csrGraph& csr = frozen();
+    startVertexId = findVertex(startActorId);
+    endVertexId = findVertex(endActorId);
+    if(startVertexId < 0 || endVertexId < 0) {
+        return result;
+    }
+
     auto algorithmStart = chrono::high_resolution_clock::now();
 
     int meetingPoint = -1;
-    result.visited = 2;
+    int visitedCount = 2; //vertices visited by either side
 
     // forward search
     queue<int> forwardQueue;
-    set<int> forwardVisited;
-    unordered_map<int, pair<int, Movie*>> forwardPrevious;
-    forwardQueue.push(startActorId);
-    forwardVisited.insert(startActorId);
+    forward.reset(csr.vertexCount(), castSnapshot.vertexCount());
+    forwardQueue.push(startVertexId);
+    forward.visit(startVertexId, -1, nullptr);
 
     // backwards search
     queue<int> backwardQueue;
-    set<int> backwardVisited;
-    unordered_map<int, pair<int, Movie*>> backwardPrevious;
-    backwardQueue.push(endActorId);
-    backwardVisited.insert(endActorId);
+    backward.reset(csr.vertexCount(), castSnapshot.vertexCount());
+    backwardQueue.push(endVertexId);
+    backward.visit(endVertexId, -1, nullptr);
 
     // BFS in both directions
     while(!forwardQueue.empty() && !backwardQueue.empty() && meetingPoint == -1) {
         int levelSize = forwardQueue.size();
         for(int i = 0; i < levelSize && meetingPoint == -1; i++) {
-            int currentActorId = forwardQueue.front();
+            int current = forwardQueue.front();
             forwardQueue.pop();
-            if(processNeighbors(currentActorId, forwardPrevious, forwardVisited, forwardQueue, backwardVisited, meetingPoint)) {
+            if(processNeighbors(current, forward, forwardQueue, backward, meetingPoint, visitedCount, result.edges)) {
                 break;
             }
         }
@@ -399,39 +756,37 @@ SearchResult Graph::findPathBDS(int startActorId, int endActorId) {
         }
         levelSize = backwardQueue.size();
         for (int i = 0; i < levelSize && meetingPoint == -1; i++) {
-            int currentId = backwardQueue.front();
+            int current = backwardQueue.front();
             backwardQueue.pop();
 
-            if (processNeighbors(currentId, backwardPrevious, backwardVisited, backwardQueue, forwardVisited, meetingPoint)) {
+            if (processNeighbors(current, backward, backwardQueue, forward, meetingPoint, visitedCount, result.edges)) {
                 break;
             }
         }
     }
 
-    set<int> totalVisited;
-    totalVisited.insert(forwardVisited.begin(), forwardVisited.end());
-    totalVisited.insert(backwardVisited.begin(), backwardVisited.end());
-    result.visited = totalVisited.size();
+    result.visited = visitedCount;
 
     if(meetingPoint != -1) {
         vector<PathStep> forwardPath;
         vector<PathStep> backwardPath;
 
         // building path forward
-        int currentActorId = meetingPoint;
-        while(currentActorId != startActorId) {
-            auto prev = forwardPrevious[currentActorId];
-            forwardPath.insert(forwardPath.begin(), PathStep(actors[currentActorId], actors[prev.first], prev.second));
-            currentActorId = prev.first;
+        int current = meetingPoint;
+        while(current != startVertexId) {
+            int prev = forward.previous[current];
+            forwardPath.push_back(PathStep(actors[current], actors[prev], forward.previousMovie[current]));
+            current = prev;
         }
-        forwardPath.insert(forwardPath.begin(), PathStep(actors[startActorId]));
+        forwardPath.push_back(PathStep(actors[startVertexId]));
+        reverse(forwardPath.begin(), forwardPath.end());
 
         // building path backwards
-        currentActorId = meetingPoint;
-        while(backwardPrevious.find(currentActorId) != backwardPrevious.end()) {
-            auto prev = backwardPrevious[currentActorId];
-            backwardPath.push_back(PathStep(actors[prev.first], actors[currentActorId], prev.second));
-            currentActorId = prev.first;
+        current = meetingPoint;
+        while(backward.previous[current] != -1) {
+            int prev = backward.previous[current];
+            backwardPath.push_back(PathStep(actors[prev], actors[current], backward.previousMovie[current]));
+            current = prev;
         }
 
         // Combine paths
@@ -445,4 +800,4 @@ SearchResult Graph::findPathBDS(int startActorId, int endActorId) {
     result.algorithm_ms = chrono::duration<double, milli>(algorithmEnd - algorithmStart).count();
 
     return result;
-}
\ No newline at end of file
+}
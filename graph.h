@@ -8,7 +8,17 @@
 #include <stack>
 #include <set>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <optional>
+#include <functional>
+#include <future>
+#include <algorithm>
 #include "api.h"
+#include "arena.h"
+#include "edgeindex.h"
 
 using namespace std;
 
@@ -16,10 +26,10 @@ using namespace std;
 
 //stores all possible edges/connections of an actor/vertix
 struct Connection {
-    int actorId;
+    int vertex; //internal id of the other actor
     vector<Movie*> movies;
 
-    Connection(int actorId) : actorId(actorId) {}
+    Connection(int vertex) : vertex(vertex) {}
     ~Connection() {}
 };
 
@@ -38,34 +48,147 @@ struct SearchResult {
     vector<PathStep> path;
     double time_ms;
     int visited;
+    long long edges; //edges the algorithm looked at
     double data_fetch_ms; //time spent fetching the data
     double algorithm_ms; //time spent in the algorithm itself
 
-    SearchResult() : time_ms(0), visited(0) {}
+    SearchResult() : time_ms(0), visited(0), edges(0), algorithm_ms(0) {}
+};
+
+//allocation counts of the actor and movie records the graph owns
+struct graphAllocStats {
+    long long actors;
+    long long movies;
+    long long slabs; //allocations made for all of them (one per slab of records)
+
+    graphAllocStats() : actors(0), movies(0), slabs(0) {}
+};
+
+//read-only copy of the adjacency list in compressed sparse row form, which the searches run on
+//the neighbours of vertex v are neighbours[offsets[v]] .. neighbours[offsets[v + 1] - 1] (in adjacency list order)
+//and edgeMovies[i] is the movie that links v to neighbours[i]
+//-> a whole neighbourhood is one contiguous slice instead of a vector per connection
+//(in bipartite mode there are two of them, actor -> movies and movie -> cast, and edgeMovies stays empty)
+struct csrGraph {
+    vector<size_t> offsets; //one more than there are vertices
+    vector<int> neighbours;
+    vector<Movie*> edgeMovies;
+
+    int vertexCount() const { return offsets.empty() ? 0 : static_cast<int>(offsets.size()) - 1; }
+};
+
+//per vertex state of one search direction
+//sized once per snapshot, and afterwards only the vertices a search touched are reset -> a search that stays
+//small (bidirectional) doesn't pay for clearing arrays the size of the whole graph
+struct searchState {
+    vector<char> visited;
+    vector<int> previous; //vertex we came from, -1 for the start (or unvisited)
+    vector<Movie*> previousMovie; //movie of that edge
+    vector<int> touched; //vertices visited since the last reset
+    vector<char> movieVisited; //bipartite mode: movies whose cast was already scanned
+    vector<int> touchedMovies;
+
+    //sizes the arrays for n vertices (and movieCount movie vertices), or clears what the last search touched
+    void reset(int n, int movieCount = 0);
+
+    void visit(int vertex, int from, Movie* movie) {
+        visited[vertex] = 1;
+        previous[vertex] = from;
+        previousMovie[vertex] = movie;
+        touched.push_back(vertex);
+    }
+
+    void visitMovie(int movieVertex) {
+        movieVisited[movieVertex] = 1;
+        touchedMovies.push_back(movieVertex);
+    }
 };
 
 class Graph {
 private:
 
     //variables
-    unordered_map<int, Actor*> actors; //(actor.id, actor.name)
+    //every Actor and Movie lives in these arenas: pointers to them stay valid for the graph's lifetime and
+    //they are all freed at once with the graph
+    slabArena<Actor> actorArena;
+    slabArena<Movie> movieArena;
+    //actors are numbered 0..n-1 in the order they are added (their vertex), TMDB ids are only used at the
+    //boundary (public functions) and translated through vertexOf -> no hashing inside the graph or the searches
+    vector<Actor*> actors; //(vertex, actor)
+    unordered_map<int, int> vertexOf; //(actor.id, vertex)
     unordered_map<int, Movie*> movies; //(movie.id, movie.title)
-    unordered_map<int, vector<Connection>> adjacencyList; //(actor.id, edges)
+    vector<vector<Connection>> adjacencyList; //(vertex, edges)
+    //where connections sit in adjacencyList, for every actor with at least indexThreshold connections
+    //(a list that short is still cheaper to scan than a hash lookup is to miss the cache)
+    //-> adding a connection never scans a long list
+    edgeIndex edges;
+    static const size_t indexThreshold = 256;
+
+    //bipartite mode: instead of a connection between every two actors of a cast (n*(n-1)/2 per movie), movies
+    //are vertices of their own and only actor <-> movie links are kept (n per movie)
+    bool bipartite;
+    vector<Movie*> movieVertices; //(movie vertex, movie)
+    unordered_map<int, int> movieVertexOf; //(movie.id, movie vertex)
+    vector<vector<int>> movieCasts; //(movie vertex, actor vertices in the order they were linked)
+    vector<vector<int>> actorMovies; //(vertex, movie vertices in the order they were linked)
+    vector<int> castStamp; //(vertex, last movie vertex whose cast it was checked against) -> no set per movie
+
     api& API;
     ofstream graphLog;
+    int fetchConcurrency; //how many cast requests expandFromActor keeps in flight at once
+    bool asyncFetching; //fetch casts with coroutines on an event loop instead of worker threads
+    bool expandOnDemand; //searches fetch the neighbourhood of an actor with no connections yet from the api
+    csrGraph snapshot; //frozen copy of adjacencyList (or actorMovies in bipartite mode) for the searches
+    csrGraph castSnapshot; //bipartite mode: frozen copy of movieCasts
+    searchState forward, backward; //search state, reused from search to search
+    bool snapshotStale; //the graph changed since the snapshot was taken
 
     //helper functions:
 
-    //adds actor to the graph structure (assumes actor is not already in the graph)
-    void addNode(Actor* actor);
+    //adds actor (allocated in actorArena) to the graph structure (assumes actor is not already in the graph),
+    //returns its vertex
+    int addNode(Actor* actor);
 
-    //checks if there is a shared movie between two actors
-    //if a shared movie is found, adds the connection/edge to the graph and breaks out of loop
+    //vertex of the actor with this TMDB id, -1 if the actor is not in the graph
+    int findVertex(int actorId) const {
+        auto it = vertexOf.find(actorId);
+        return it != vertexOf.end() ? it->second : -1;
+    }
+
+    //checks if there are shared movies between two actors by intersecting both filmographies
+    //every shared movie is added to the connection/edge between them
     void findSharedMovie(Actor* actor, int targetActorID);
 
-    //add a connection between actors through a movie
-    //if a connection is successful returns true, if it already exits returns false
-    bool addConnection(int actorId1, int actorId2, Movie* movie);
+    //add a connection between actors (vertices) through a movie, or the movie to their existing connection
+    //constant time (a short scan or the edge index), returns false if one of the vertices is not in the graph
+    //(or both are the same)
+    bool addConnection(int vertex1, int vertex2, Movie* movie);
+
+    //adds every connection of vertex to the edge index (called once, when it reaches indexThreshold connections)
+    void indexVertex(int vertex);
+
+    //bipartite mode: links every actor of castVertices to the movie (adding the movie vertex if needed),
+    //actors already linked to it are skipped, returns how many links were added
+    int linkCast(Movie* movie, const vector<int>& castVertices);
+
+    //gives a new vertex its list in the mode's structure: connections (clique) or movies (bipartite)
+    //-> the other structure stays empty instead of holding an unused list per actor
+    void addVertexList() {
+        if (bipartite) {
+            actorMovies.emplace_back();
+        } else {
+            adjacencyList.emplace_back();
+        }
+    }
+
+    //how many connections (clique mode) or movies (bipartite mode) an actor has
+    size_t degree(int vertex) const {
+        const size_t v = static_cast<size_t>(vertex);
+        if (bipartite) {
+            return v < actorMovies.size() ? actorMovies[v].size() : 0;
+        }
+        return v < adjacencyList.size() ? adjacencyList[v].size() : 0;
+    }
 
     //expands the graph from a given actor by:
     // - fetching all their movies
@@ -73,13 +196,30 @@ private:
     // - adding the ones who are not on graph already and connecting them to original actor
     void expandFromActor(int actorID, set<int>& targetSet);
 
-    //TODO:
-    bool processNeighbors(int currentId, unordered_map<int, pair<int, Movie*>>& previous,
-                           set<int>& visited, queue<int>& q, set<int>& otherVisited,
-                           int& meetingPoint);
+    //fetches the cast of every movie using fetchConcurrency worker threads
+    //onCast(index, cast) is called on the calling thread only, in the same order as movies, as soon as
+    //each cast (and every one before it) has arrived -> the graph is only ever written by one thread
+    void fetchCasts(const vector<Movie>& movies, const function<void(size_t, vector<Actor>&)>& onCast);
+
+    //same contract as fetchCasts, but fetchConcurrency coroutines share one event loop on the calling thread
+    //(no worker threads, no locks: casts are merged in between transfers)
+    void fetchCastsAsync(const vector<Movie>& movies, const function<void(size_t, vector<Actor>&)>& onCast);
+
+    //returns the csr snapshot, rebuilding it (and resizing the search state) first if the graph changed since it was taken
+    const csrGraph& frozen();
+
+    //calls visit(neighbour, movie) for every actor next to current (one movie away in bipartite mode) that side
+    //hasn't visited yet, until visit returns true; bipartite mode scans each movie's cast once per search
+    template <typename Visit>
+    void forEachNewNeighbour(int current, searchState& side, long long& edges, Visit visit);
+
+    //one step of bidirectional search: visits the neighbours of vertex current
+    //returns true if one of them was already visited by the other side (meetingPoint is set to it)
+    bool processNeighbors(int current, searchState& side, queue<int>& q, const searchState& otherSide,
+                          int& meetingPoint, int& visitedCount, long long& edges);
 
 public:
-    Graph(api& apiInstance) : API(apiInstance) { //constructor
+    Graph(api& apiInstance, int concurrency = 8) : bipartite(false), API(apiInstance), fetchConcurrency(max(1, concurrency)), asyncFetching(false), expandOnDemand(true), snapshotStale(true) { //constructor
         graphLog.open("graphLog.txt");
         if (!graphLog.is_open()) {
             graphLog << "ERROR: Error opening graph log file" << endl;
@@ -87,32 +227,57 @@ public:
     }
 
     ~Graph() { //destructor
-        //delete actors
-        for (auto& pair : actors)
-            delete pair.second;
-        //delete movies
-        for (auto& pair : movies)
-            delete pair.second;
+        //actors and movies are freed by their arenas
         //close log file
         if (graphLog.is_open()) {
             graphLog.close();
         }
     }
 
+    //sets how many requests are kept in flight while expanding (at least 1)
+    void setFetchConcurrency(int concurrency) { fetchConcurrency = max(1, concurrency); }
+
+    //switches cast fetching between worker threads (default) and coroutines on an event loop
+    void setAsyncFetching(bool enabled) { asyncFetching = enabled; }
+
+    //stores movies as vertices linked to their cast instead of connecting every two actors of a cast
+    //(far less memory for big casts, same paths); only possible while the graph is still empty
+    void setBipartite(bool enabled);
+    bool isBipartite() const { return bipartite; }
+
+    //turns off api requests during searches, for graphs that were built up front (bulk import)
+    void setExpandOnDemand(bool enabled) { expandOnDemand = enabled; }
+
     //adds actor to the graph given a pointer to that actor object and the id of actor we want to connect it with
+    //the graph takes ownership: the record is moved into the graph's arena and actor is deleted
     void addActor(Actor* actor, int targetActorID);
 
     //adds movie to movie map and returns a pointer to it
     Movie* addMovie(int id, const string& title, const string& release_date, const string& poster_path);
 
+    //adds a whole cast at once (bulk import): members not in the graph yet become nodes and every pair of
+    //them is connected through the movie -> a cast of n adds up to n*(n-1)/2 connections
+    //names of new actors are moved out of cast
+    void addCast(const Movie& movie, vector<Actor>& cast);
+
+    //return the actor/movie with this id, nullptr if it is not in the graph
+    Actor* getActor(int id) const { int vertex = findVertex(id); return vertex >= 0 ? actors[vertex] : nullptr; }
+    Movie* getMovie(int id) const { auto it = movies.find(id); return it != movies.end() ? it->second : nullptr; }
+
+    //returns the actor with exactly this name, nullptr if there is none in the graph
+    Actor* findActorByName(const string& name) const;
+
     //performs a breadth-first search on the graph to find path between two actors
     SearchResult findPathBFS(int startActorId, int endActorId);
 
     //returns the graph statistics -> in the pair:
     // - first value: total number of actors (vertices) in graph
-    // - second value: total number of edges between actors
+    // - second value: total number of edges between actors (actor <-> movie links in bipartite mode)
     pair<int, int> getStats() const;
 
+    //how many actor/movie records the graph holds and how many allocations they took
+    graphAllocStats getAllocStats() const;
+
     // TODO:
      SearchResult findPathBDS(int startActorId, int endActorId);
 
@@ -0,0 +1,65 @@
+#include <iostream>
+#include "graph.h"
+
+using namespace std;
+
+//regression checks for the graph structure (no api requests: everything goes through addCast)
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cout << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+//a cast with actor hubId and actors firstId .. firstId + count - 1
+vector<Actor> castOf(int hubId, int firstId, int count) {
+    vector<Actor> cast;
+    cast.emplace_back(hubId, "Hub " + to_string(hubId), "");
+    for (int id = firstId; id < firstId + count; id++) {
+        cast.emplace_back(id, "Person " + to_string(id), "");
+    }
+    return cast;
+}
+
+//two actors that reach the edge index threshold with the same connection: that connection has to be indexed
+//too, otherwise the next movie of the pair adds a second connection instead of extending the first
+void testBothReachIndexThreshold(api& tmdb) {
+    Graph graph(tmdb);
+    graph.setExpandOnDemand(false);
+
+    //255 connections each
+    vector<Actor> castA = castOf(1, 1000, 255);
+    graph.addCast(Movie(100, "A", "2000", ""), castA);
+    vector<Actor> castB = castOf(2, 2000, 255);
+    graph.addCast(Movie(101, "B", "2000", ""), castB);
+    int before = graph.getStats().second;
+
+    //both hubs reach 256 with this one
+    vector<Actor> pair1 = {Actor(1, "Hub 1", ""), Actor(2, "Hub 2", "")};
+    graph.addCast(Movie(102, "C", "2000", ""), pair1);
+    check(graph.getStats().second == before + 1, "movie C adds one connection");
+
+    //same pair again -> same connection
+    vector<Actor> pair2 = {Actor(1, "Hub 1", ""), Actor(2, "Hub 2", "")};
+    graph.addCast(Movie(103, "D", "2000", ""), pair2);
+    check(graph.getStats().second == before + 1, "movie D reuses the connection of movie C");
+
+    SearchResult result = graph.findPathBFS(1, 2);
+    check(result.path.size() == 2 && result.path[1].movie->id == 102, "hubs are linked through movie C");
+}
+
+int main() {
+    api tmdb("test", "http://127.0.0.1:9/3"); //never contacted
+
+    testBothReachIndexThreshold(tmdb);
+
+    if (failures > 0) {
+        cout << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "All graph checks passed" << endl;
+    return 0;
+}
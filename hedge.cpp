@@ -0,0 +1,50 @@
+#include "hedge.h"
+
+#include <algorithm>
+#include <cmath>
+
+hedgePolicy::hedgePolicy(double budget, size_t window)
+    : window(max(window, minSamples)), nextSample(0), budget(budget), requests(0), hedges(0), wins(0) {
+    samples.reserve(this->window);
+}
+
+void hedgePolicy::record(double ms) {
+    lock_guard<mutex> lock(policyMutex);
+    requests++;
+    if (samples.size() < window) {
+        samples.push_back(ms);
+    } else {
+        samples[nextSample] = ms;
+        nextSample = (nextSample + 1) % samples.size();
+    }
+}
+
+chrono::milliseconds hedgePolicy::delay() const {
+    vector<double> sorted;
+    {
+        lock_guard<mutex> lock(policyMutex);
+        if (samples.size() < minSamples) {
+            return chrono::milliseconds::zero();
+        }
+        sorted = samples;
+    }
+
+    //95th percentile of the recent latencies
+    size_t index = static_cast<size_t>(ceil(sorted.size() * 0.95)) - 1;
+    nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return chrono::milliseconds(max(1LL, static_cast<long long>(ceil(sorted[index]))));
+}
+
+bool hedgePolicy::tryHedge() {
+    lock_guard<mutex> lock(policyMutex);
+    if (hedges + 1 > budget * max(1LL, requests)) {
+        return false;
+    }
+    hedges++;
+    return true;
+}
+
+long long hedgePolicy::hedgeCount() const {
+    lock_guard<mutex> lock(policyMutex);
+    return hedges;
+}
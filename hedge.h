@@ -0,0 +1,46 @@
+#ifndef HEDGE_H
+#define HEDGE_H
+
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+using namespace std;
+
+//decides when a slow request gets a duplicate (hedged request)
+// - keeps the latencies of the last requests and hedges once a request takes longer than their 95th percentile
+// - hedges are capped by a budget (a fraction of all requests), so a slow server doesn't get twice the load
+class hedgePolicy {
+private:
+    mutable mutex policyMutex;
+    vector<double> samples; //latencies in ms, used as a ring buffer
+    size_t window; //how many of the last latencies are kept
+    size_t nextSample;
+    double budget; //at most this fraction of requests may be hedged
+    long long requests;
+    long long hedges;
+    atomic<long long> wins; //hedges that answered before the original request
+
+    static constexpr size_t minSamples = 20; //no hedging until the percentile means something
+
+public:
+    hedgePolicy(double budget = 0.05, size_t window = 200); //constructor
+
+    //adds the latency of a finished request
+    void record(double ms);
+
+    //how long to wait before hedging a request (zero -> don't hedge)
+    chrono::milliseconds delay() const;
+
+    //called when a request reaches the delay: returns true (and counts a hedge) if the budget allows one
+    bool tryHedge();
+
+    //called when the hedge answered first
+    void countWin() { wins++; }
+
+    long long hedgeCount() const;
+    long long winCount() const { return wins; }
+};
+
+#endif //HEDGE_H
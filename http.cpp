@@ -0,0 +1,291 @@
+#include "http.h"
+
+#include <cctype>
+
+httpClient::httpClient() {
+    //curl_global_init is not thread safe, so it only runs once for the whole program
+    static once_flag curlInit;
+    call_once(curlInit, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockCallback);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockCallback);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+}
+
+httpClient::~httpClient() {
+    //handles have to be cleaned up before the share object they use
+    for (connection* conn : idleConnections) {
+        curl_easy_cleanup(conn->handle);
+        delete conn;
+    }
+    curl_share_cleanup(share);
+}
+
+size_t httpClient::writeCallback(char* data, size_t size, size_t count, void* userdata) {
+    connection* conn = static_cast<connection*>(userdata);
+
+    //first chunk: make room for the whole body at once if the server told us its size
+    if (conn->buffer.empty()) {
+        curl_off_t length = -1;
+        curl_easy_getinfo(conn->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (length > 0 && static_cast<size_t>(length) > conn->buffer.capacity()) {
+            conn->buffer.reserve(static_cast<size_t>(length));
+        }
+    }
+
+    conn->buffer.append(data, size * count);
+    return size * count;
+}
+
+void parseHeaderLine(const char* data, size_t length, httpResponse& response) {
+    string line(data, length);
+
+    //"Name: value\r\n" -> headers["name"] = "value" (status line and blank line have no colon)
+    size_t colon = line.find(':');
+    if (colon != string::npos) {
+        string name = line.substr(0, colon);
+        for (char& c : name) {
+            c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+        size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+        size_t valueEnd = line.find_last_not_of(" \t\r\n");
+        response.headers[name] = valueStart == string::npos || valueEnd < valueStart ? "" : line.substr(valueStart, valueEnd - valueStart + 1);
+    }
+}
+
+size_t httpClient::headerCallback(char* data, size_t size, size_t count, void* userdata) {
+    parseHeaderLine(data, size * count, *static_cast<httpResponse*>(userdata));
+    return size * count;
+}
+
+void httpClient::lockCallback(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<httpClient*>(userptr)->shareMutexes[data].lock();
+}
+
+void httpClient::unlockCallback(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<httpClient*>(userptr)->shareMutexes[data].unlock();
+}
+
+httpClient::connection* httpClient::acquireConnection() {
+    {
+        lock_guard<mutex> lock(poolMutex);
+        if (!idleConnections.empty()) {
+            connection* conn = idleConnections.back();
+            idleConnections.pop_back();
+            return conn;
+        }
+    }
+
+    //pool is empty -> create a new connection
+    CURL* handle = curl_easy_init();
+    if (handle == nullptr) {
+        return nullptr;
+    }
+
+    connection* conn = new connection();
+    conn->handle = handle;
+    conn->errorBuffer[0] = '\0';
+
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, conn);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, conn->errorBuffer);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L); //required when handles are used from several threads
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, ""); //every encoding libcurl was built with (gzip, deflate, ...)
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT, 30L);
+    return conn;
+}
+
+void httpClient::releaseConnection(connection* conn) {
+    //keep the buffer's capacity for the next request, unless an unusually big response made it huge
+    conn->buffer.clear();
+    if (conn->buffer.capacity() > maxRetainedBuffer) {
+        string().swap(conn->buffer);
+    }
+
+    lock_guard<mutex> lock(poolMutex);
+    idleConnections.push_back(conn);
+}
+
+void httpClient::prepare(connection* conn, const string& url, curl_slist* headers, httpResponse& response) {
+    conn->errorBuffer[0] = '\0';
+    curl_easy_setopt(conn->handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(conn->handle, CURLOPT_HEADERDATA, &response);
+    curl_easy_setopt(conn->handle, CURLOPT_HTTPHEADER, headers);
+}
+
+void httpClient::finish(connection* conn, CURLcode result, httpResponse& response) {
+    if (result == CURLE_OK) {
+        curl_easy_getinfo(conn->handle, CURLINFO_RESPONSE_CODE, &response.status);
+        curl_off_t downloaded = 0;
+        curl_easy_getinfo(conn->handle, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+        response.wireBytes = static_cast<size_t>(downloaded);
+        response.body.assign(conn->buffer); //one allocation of exactly the body's size
+    } else {
+        response.error = conn->errorBuffer[0] != '\0' ? conn->errorBuffer : curl_easy_strerror(result);
+    }
+
+    //the handle goes back to the pool -> it must not keep pointing at this request's headers
+    curl_easy_setopt(conn->handle, CURLOPT_HTTPHEADER, nullptr);
+}
+
+httpResponse httpClient::get(const string &url, const vector<string>& headers, chrono::milliseconds hedgeAfter,
+                             const function<bool()>& mayHedge) {
+    curl_slist* requestHeaders = nullptr;
+    for (const string& header : headers) {
+        requestHeaders = curl_slist_append(requestHeaders, header.c_str());
+    }
+
+    httpResponse response;
+    if (hedgeAfter > chrono::milliseconds::zero() && mayHedge) {
+        response = getHedged(url, requestHeaders, hedgeAfter, mayHedge);
+        curl_slist_free_all(requestHeaders);
+        return response;
+    }
+
+    connection* conn = acquireConnection();
+    if (conn == nullptr) {
+        curl_slist_free_all(requestHeaders);
+        response.error = "could not create curl handle";
+        return response;
+    }
+
+    prepare(conn, url, requestHeaders, response);
+    finish(conn, curl_easy_perform(conn->handle), response);
+    releaseConnection(conn);
+
+    curl_slist_free_all(requestHeaders);
+    return response;
+}
+
+httpResponse httpClient::getHedged(const string& url, curl_slist* headers, chrono::milliseconds hedgeAfter,
+                                   const function<bool()>& mayHedge) {
+    CURLM* multi = curl_multi_init();
+    httpResponse response;
+    {
+        hedgedRequest request(*this, multi, url, headers);
+        if (!request.start()) {
+            curl_multi_cleanup(multi);
+            response.error = "could not create curl handle";
+            return response;
+        }
+
+        auto hedgeAt = chrono::steady_clock::now() + hedgeAfter;
+        bool hedgeDecided = false;
+        while (!request.decided()) {
+            int running = 0;
+            curl_multi_perform(multi, &running);
+
+            int remaining = 0;
+            while (CURLMsg* message = curl_multi_info_read(multi, &remaining)) {
+                if (message->msg == CURLMSG_DONE && request.legDone(message->easy_handle, message->data.result)) {
+                    break;
+                }
+            }
+            if (request.decided()) {
+                break;
+            }
+
+            //slow -> send the duplicate (once), and let perform start it right away
+            if (!hedgeDecided && chrono::steady_clock::now() >= hedgeAt) {
+                hedgeDecided = true;
+                if (request.hedge(mayHedge)) {
+                    continue;
+                }
+            }
+
+            long timeoutMs = 1000;
+            if (!hedgeDecided) {
+                auto untilHedge = chrono::duration_cast<chrono::milliseconds>(hedgeAt - chrono::steady_clock::now());
+                timeoutMs = max(0L, min(timeoutMs, static_cast<long>(untilHedge.count()) + 1));
+            }
+            curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeoutMs), nullptr);
+        }
+        response = request.takeResult();
+    }
+    curl_multi_cleanup(multi);
+    return response;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+hedgedRequest::hedgedRequest(httpClient& client, CURLM* multi, const string& url, curl_slist* headers, void* owner)
+    : client(client), multi(multi), url(url), headers(headers), owner(owner), legs{nullptr, nullptr},
+      started(0), ended(0), winner(-1) {}
+
+hedgedRequest::~hedgedRequest() {
+    releaseLegs();
+}
+
+bool hedgedRequest::startLeg(int leg) {
+    legs[leg] = client.acquireConnection();
+    if (legs[leg] == nullptr) {
+        return false;
+    }
+    client.prepare(legs[leg], url, headers, responses[leg]);
+    curl_easy_setopt(legs[leg]->handle, CURLOPT_PRIVATE, owner);
+    if (curl_multi_add_handle(multi, legs[leg]->handle) != CURLM_OK) {
+        curl_easy_setopt(legs[leg]->handle, CURLOPT_HTTPHEADER, nullptr);
+        client.releaseConnection(legs[leg]);
+        legs[leg] = nullptr;
+        return false;
+    }
+    started++;
+    return true;
+}
+
+bool hedgedRequest::start() {
+    return started == 0 && startLeg(0);
+}
+
+bool hedgedRequest::hedge(const function<bool()>& mayHedge) {
+    if (started != 1 || ended != 0 || !mayHedge || !mayHedge()) {
+        return false;
+    }
+    return startLeg(1);
+}
+
+bool hedgedRequest::legDone(CURL* handle, CURLcode result) {
+    int leg = legs[0] != nullptr && legs[0]->handle == handle ? 0 : 1;
+    if (winner >= 0 || legs[leg] == nullptr || legs[leg]->handle != handle) {
+        return winner >= 0; //not one of ours, or already decided
+    }
+    curl_multi_remove_handle(multi, handle);
+    client.finish(legs[leg], result, responses[leg]);
+    ended++;
+
+    //a failed leg only decides the request if there is no other leg left to wait for
+    if (responses[leg].error.empty() || ended == started) {
+        winner = leg;
+    }
+    return winner >= 0;
+}
+
+void hedgedRequest::releaseLegs() {
+    //a leg that is still running is stopped by taking it off the multi handle
+    for (httpClient::connection*& conn : legs) {
+        if (conn != nullptr) {
+            curl_multi_remove_handle(multi, conn->handle);
+            curl_easy_setopt(conn->handle, CURLOPT_HTTPHEADER, nullptr);
+            curl_easy_setopt(conn->handle, CURLOPT_PRIVATE, nullptr);
+            client.releaseConnection(conn);
+            conn = nullptr;
+        }
+    }
+}
+
+httpResponse hedgedRequest::takeResult() {
+    bool duplicateSent = started > 1;
+    releaseLegs();
+    httpResponse response = move(responses[winner]);
+    response.hedged = duplicateSent;
+    response.hedgeWon = winner == 1;
+    return response;
+}
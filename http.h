@@ -0,0 +1,143 @@
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <curl/curl.h>
+
+using namespace std;
+
+//result of a single http request
+struct httpResponse {
+    long status; //http status code (0 if the transfer itself failed)
+    string body;
+    string error; //curl error message when the transfer failed
+    unordered_map<string, string> headers; //response headers (names in lowercase)
+    size_t wireBytes; //body bytes as they came over the network (compressed, if the server compressed them)
+    bool hedged; //a duplicate request was sent because this one was slow
+    bool hedgeWon; //and the duplicate answered first
+
+    httpResponse() : status(0), wireBytes(0), hedged(false), hedgeWon(false) {}
+};
+
+//adds one raw header line ("Name: value\r\n") to response.headers, ignores lines without a colon
+void parseHeaderLine(const char* data, size_t length, httpResponse& response);
+
+//in-process http client built on libcurl (replaces shelling out to the curl binary)
+// - keeps a pool of connections (easy handles), so a finished request leaves its connection open for the next one
+// - every handle shares one connection cache, dns cache and tls session cache, so a new handle
+//   can pick up an open connection or resume a tls session instead of doing a full handshake
+// - response bodies are streamed into a receive buffer owned by the connection; the buffer keeps its capacity
+//   between requests, so a response doesn't regrow a string chunk by chunk and nothing touches the filesystem
+// - each request uses its own connection from the pool, so get can be called from many threads at once
+// - gzip/deflate is negotiated with Accept-Encoding; libcurl inflates each chunk as it arrives, so only the
+//   decoded json ever lands in the receive buffer
+//the pool is also where eventLoop takes its connections from, so async requests are set up the same way and
+//share the same open connections, dns and tls sessions
+class httpClient {
+public:
+    //one pooled connection and everything a request on it writes into
+    struct connection {
+        CURL* handle;
+        string buffer; //receive buffer, reused by every request on this connection
+        char errorBuffer[CURL_ERROR_SIZE];
+    };
+
+private:
+    CURLSH* share;
+    vector<connection*> idleConnections; //connections not currently in use, reused by the next request
+    mutex poolMutex;
+    mutex shareMutexes[CURL_LOCK_DATA_LAST]; //one lock per kind of shared data
+
+    //receive buffers bigger than this are released after the request instead of kept in the pool
+    static const size_t maxRetainedBuffer = 1024 * 1024;
+
+    //runs the request and, if it is still running after hedgeAfter and mayHedge agrees, a duplicate of it
+    //on a private multi handle -> returns whichever answers first
+    httpResponse getHedged(const string& url, curl_slist* headers, chrono::milliseconds hedgeAfter, const function<bool()>& mayHedge);
+
+    //libcurl callbacks
+    static size_t writeCallback(char* data, size_t size, size_t count, void* userdata);
+    static size_t headerCallback(char* data, size_t size, size_t count, void* userdata);
+    static void lockCallback(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlockCallback(CURL* handle, curl_lock_data data, void* userptr);
+
+public:
+    httpClient(); //constructor
+    ~httpClient(); //destructor
+
+    httpClient(const httpClient&) = delete;
+    httpClient& operator=(const httpClient&) = delete;
+
+    //performs a GET request and returns the status code and body
+    //headers are extra request headers, e.g. "If-None-Match: \"abc\""
+    //hedging: if the request hasn't finished after hedgeAfter (zero -> never) and mayHedge returns true,
+    //the same request is sent again on another connection and the first answer wins
+    httpResponse get(const string& url, const vector<string>& headers = {},
+                     chrono::milliseconds hedgeAfter = chrono::milliseconds::zero(), const function<bool()>& mayHedge = nullptr);
+
+    //takes a connection from the pool (or opens a new one), null if curl can't create a handle
+    connection* acquireConnection();
+    //gives a connection back to the pool (it must not be attached to a multi handle anymore)
+    void releaseConnection(connection* conn);
+
+    //points a connection at a request (headers can be null), response receives the headers
+    void prepare(connection* conn, const string& url, curl_slist* headers, httpResponse& response);
+
+    //fills in the response once the transfer on conn has ended with result
+    void finish(connection* conn, CURLcode result, httpResponse& response);
+};
+
+//one request run on a multi handle as the original and, once it turns out slow, a duplicate on another
+//connection: the first answer wins, a failed leg only decides the request if no other leg is left
+//used by httpClient::getHedged (on a private multi handle) and by eventLoop (next to its other transfers),
+//which only differ in how they wait for the multi handle
+class hedgedRequest {
+private:
+    httpClient& client;
+    CURLM* multi;
+    string url;
+    curl_slist* headers;
+    void* owner; //set as CURLOPT_PRIVATE of every leg, so the multi handle's owner can find the request
+    httpClient::connection* legs[2]; //original and duplicate (null until started)
+    httpResponse responses[2];
+    int started;
+    int ended;
+    int winner; //-1 while undecided
+
+    bool startLeg(int leg);
+
+    //detaches the legs from the multi handle and returns their connections to the pool
+    void releaseLegs();
+
+public:
+    //headers stay owned by the caller and must outlive the request
+    hedgedRequest(httpClient& client, CURLM* multi, const string& url, curl_slist* headers, void* owner = nullptr);
+    ~hedgedRequest();
+
+    hedgedRequest(const hedgedRequest&) = delete;
+    hedgedRequest& operator=(const hedgedRequest&) = delete;
+
+    //sends the original request, false if there was no connection for it
+    bool start();
+
+    //sends the duplicate if only the original is running and mayHedge agrees, returns true if it was sent
+    bool hedge(const function<bool()>& mayHedge);
+
+    //one of the legs ended (handle as reported by curl_multi_info_read), returns true once the request is decided
+    bool legDone(CURL* handle, CURLcode result);
+
+    bool decided() const { return winner >= 0; }
+
+    //legs still on the wire
+    int running() const { return started - ended; }
+
+    //the winning response (with hedged/hedgeWon filled in), only once decided; the legs go back to the pool
+    httpResponse takeResult();
+};
+
+#endif //HTTP_H
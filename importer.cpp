@@ -0,0 +1,199 @@
+#include "importer.h"
+
+#include <deque>
+#include <algorithm>
+
+bulkImporter::bulkImporter(Graph& graph, int workers, const castPolicy& policy, size_t batchLines)
+    : graph(graph), policy(policy) {
+    this->workers = workers > 0 ? static_cast<size_t>(workers) : max(1u, thread::hardware_concurrency());
+    this->batchLines = max<size_t>(1, batchLines);
+    maxBatches = this->workers * 2; //enough to keep every worker busy while the builder catches up
+}
+
+bool bulkImporter::stream(const string& path, const function<void(batch&)>& parse, const function<void(batch&)>& build) {
+    auto start = chrono::high_resolution_clock::now();
+    error.clear();
+
+    gzipLineReader reader(path);
+    if (!reader.isOpen()) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    //batches read but not built yet, oldest first (deque keeps references valid while both ends change)
+    deque<batch> window;
+    size_t builtCount = 0; //number of the batch at the front of the window
+    size_t readCount = 0;
+    size_t nextParse = 0;
+    bool readDone = false;
+    mutex windowMutex;
+    condition_variable windowChanged;
+
+    //the reader waits whenever maxBatches batches are already waiting -> bounded memory
+    thread readerThread([&]() {
+        while (true) {
+            batch next;
+            next.lines.reserve(batchLines);
+            string line;
+            while (next.lines.size() < batchLines && reader.getline(line)) {
+                next.lines.push_back(move(line));
+            }
+            if (next.lines.empty()) {
+                break;
+            }
+
+            unique_lock<mutex> lock(windowMutex);
+            windowChanged.wait(lock, [&] { return window.size() < maxBatches; });
+            window.push_back(move(next));
+            readCount++;
+            windowChanged.notify_all();
+        }
+
+        lock_guard<mutex> lock(windowMutex);
+        readDone = true;
+        windowChanged.notify_all();
+    });
+
+    //each worker keeps taking the next batch nobody has parsed yet
+    auto worker = [&]() {
+        while (true) {
+            batch* work = nullptr;
+            {
+                unique_lock<mutex> lock(windowMutex);
+                windowChanged.wait(lock, [&] { return nextParse < readCount || readDone; });
+                if (nextParse >= readCount) {
+                    break;
+                }
+                work = &window[nextParse - builtCount];
+                nextParse++;
+            }
+
+            //an exception must not get past the thread (it would terminate the import) -> the whole batch counts
+            //as bad lines instead
+            try {
+                parse(*work);
+            } catch (const exception&) {
+                work->names.clear();
+                work->casts.clear();
+                work->dropped = 0;
+                work->badLines = count_if(work->lines.begin(), work->lines.end(), [](const string& line) { return !line.empty(); });
+            }
+            vector<string>().swap(work->lines); //raw lines are not needed anymore
+
+            lock_guard<mutex> lock(windowMutex);
+            work->parsed = true;
+            windowChanged.notify_all();
+        }
+    };
+
+    vector<thread> parsers;
+    for (size_t i = 0; i < workers; i++) {
+        parsers.emplace_back(worker);
+    }
+
+    //build in file order while the remaining batches are still being read and parsed
+    while (true) {
+        batch* work = nullptr;
+        {
+            unique_lock<mutex> lock(windowMutex);
+            windowChanged.wait(lock, [&] { return (!window.empty() && window.front().parsed) || (readDone && window.empty()); });
+            if (window.empty()) {
+                break;
+            }
+            work = &window.front();
+        }
+
+        stats.lines += static_cast<long long>(work->names.size() + work->casts.size() + work->badLines);
+        stats.badLines += work->badLines;
+        stats.castDropped += static_cast<long long>(work->dropped);
+        build(*work);
+
+        lock_guard<mutex> lock(windowMutex);
+        window.pop_front();
+        builtCount++;
+        windowChanged.notify_all();
+    }
+
+    readerThread.join();
+    for (auto& t : parsers) {
+        t.join();
+    }
+
+    stats.ms += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    if (!reader.lastError().empty()) {
+        error = path + ": " + reader.lastError();
+        return false;
+    }
+    return true;
+}
+
+void bulkImporter::parseExport(batch& work, const string& nameField) {
+    work.names.reserve(work.lines.size());
+    for (const string& line : work.lines) {
+        if (line.empty()) {
+            continue;
+        }
+        json entry = json::parse(line, nullptr, false);
+        if (entry.is_discarded() || !entry.is_object() || !entry.contains("id") || !entry["id"].is_number_integer()) {
+            work.badLines++;
+            continue;
+        }
+        //the name may be missing, but if it is there it has to be a string (null or a number is a bad line)
+        auto name = entry.find(nameField);
+        if (name != entry.end() && !name->is_string()) {
+            work.badLines++;
+            continue;
+        }
+        work.names.emplace_back(entry["id"].get<int>(), name != entry.end() ? name->get<string>() : "");
+    }
+}
+
+bool bulkImporter::importCredits(const string& path) {
+    return stream(path, [&](batch& work) {
+        work.casts.reserve(work.lines.size());
+        for (const string& line : work.lines) {
+            if (line.empty()) {
+                continue;
+            }
+            Movie movie(0, "Unknown title", "", "");
+            vector<Actor> cast;
+            string parseError;
+            size_t dropped = 0;
+            if (!parseMovieCredits(line, movie, cast, parseError, policy, &dropped) || movie.id == 0) {
+                work.badLines++;
+                continue;
+            }
+            work.dropped += dropped;
+            work.casts.emplace_back(move(movie), move(cast));
+        }
+    }, [&](batch& work) {
+        for (auto& record : work.casts) {
+            graph.addCast(record.first, record.second);
+            stats.movies++;
+        }
+    });
+}
+
+bool bulkImporter::importPeople(const string& path) {
+    return stream(path, [](batch& work) { parseExport(work, "name"); }, [&](batch& work) {
+        for (auto& entry : work.names) {
+            Actor* actor = graph.getActor(entry.first);
+            if (actor != nullptr && actor->name == "Unknown name" && !entry.second.empty()) {
+                actor->name = move(entry.second);
+                stats.namesFilled++;
+            }
+        }
+    });
+}
+
+bool bulkImporter::importMovies(const string& path) {
+    return stream(path, [](batch& work) { parseExport(work, "original_title"); }, [&](batch& work) {
+        for (auto& entry : work.names) {
+            Movie* movie = graph.getMovie(entry.first);
+            if (movie != nullptr && movie->title == "Unknown title" && !entry.second.empty()) {
+                movie->title = move(entry.second);
+                stats.namesFilled++;
+            }
+        }
+    });
+}
@@ -0,0 +1,83 @@
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "graph.h"
+#include "credits.h"
+#include "compress.h"
+
+using namespace std;
+
+//counters of a bulk import
+struct importStats {
+    long long lines; //lines read from all files
+    long long movies; //movie records of the credits dump added to the graph
+    long long badLines; //lines that were not valid json or had no id (skipped)
+    long long castDropped; //cast entries the cast policy left out
+    long long namesFilled; //actor names and movie titles the exports filled in
+    double ms; //total time spent importing
+
+    importStats() : lines(0), movies(0), badLines(0), castDropped(0), namesFilled(0), ms(0) {}
+};
+
+//builds the graph offline, without a single api request, from:
+// - a credits dump: one /movie/{id}?append_to_response=credits response per line
+// - TMDB's daily id exports (person_ids / movie_ids): one {"id":..,"name"/"original_title":..} object per line,
+//   used to fill in names and titles the dump doesn't have
+//files can be gzip'd or plain text
+//each file is read on one thread, batches of lines are parsed on worker threads and the parsed batches are added
+//to the graph on the calling thread, in file order -> the graph is only ever written by one thread and comes out
+//the same no matter how many workers there are
+//at most maxBatches batches are in memory at once (read but not added yet), so memory stays bounded by the graph
+//itself, whatever the size of the files
+class bulkImporter {
+private:
+    //a batch of lines and what a worker made of it
+    struct batch {
+        vector<string> lines;
+        vector<pair<int, string>> names; //export entries: (id, name or title)
+        vector<pair<Movie, vector<Actor>>> casts; //credits dump entries
+        long long badLines;
+        size_t dropped;
+        bool parsed;
+
+        batch() : badLines(0), dropped(0), parsed(false) {}
+    };
+
+    Graph& graph;
+    size_t workers;
+    size_t batchLines;
+    size_t maxBatches;
+    castPolicy policy;
+    importStats stats;
+    string error;
+
+    //reads path in batches and runs parse (worker threads) and build (calling thread, in file order) on each
+    //returns false if the file can't be opened or is cut short (everything read up to there is still built)
+    bool stream(const string& path, const function<void(batch&)>& parse, const function<void(batch&)>& build);
+
+    //parses an export file: nameField is "name" for people, "original_title" for movies
+    static void parseExport(batch& work, const string& nameField);
+
+public:
+    //workers = 0 -> one per core
+    bulkImporter(Graph& graph, int workers = 0, const castPolicy& policy = castPolicy(), size_t batchLines = 256);
+
+    //adds every movie of the credits dump and its cast (every pair of cast members gets connected, or every
+    //cast member gets linked to the movie if the graph is bipartite)
+    bool importCredits(const string& path);
+
+    //fill in names/titles of actors and movies already in the graph (run after importCredits)
+    //only entries the graph has are touched, so the exports are never held in memory
+    bool importPeople(const string& path);
+    bool importMovies(const string& path);
+
+    importStats getStats() const { return stats; }
+
+    //why the last import returned false
+    const string& lastError() const { return error; }
+};
+
+#endif //IMPORTER_H
@@ -0,0 +1,148 @@
+#include "limiter.h"
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <ctime>
+
+rateLimiter::rateLimiter(double ratePerSecond, int burst, int initialConcurrency, int maxConcurrency)
+    : ratePerSecond(ratePerSecond), burst(burst), tokens(burst), lastRefill(clock::now()),
+      concurrencyLimit(max(1, initialConcurrency)), maxConcurrency(max(1, maxConcurrency)), inFlight(0),
+      pausedUntil(clock::now()), lastDecrease(clock::now()) {}
+
+void rateLimiter::refill(clock::time_point now) {
+    double elapsed = chrono::duration<double>(now - lastRefill).count();
+    tokens = min(burst, tokens + elapsed * ratePerSecond);
+    lastRefill = now;
+}
+
+rateLimiter::clock::time_point rateLimiter::acquire() {
+    unique_lock<mutex> lock(limiterMutex);
+
+    while (true) {
+        clock::time_point now = clock::now();
+
+        //server asked us to back off
+        if (now < pausedUntil) {
+            stateChanged.wait_until(lock, pausedUntil);
+            continue;
+        }
+
+        //too many requests in flight -> wait for one to finish
+        if (inFlight >= static_cast<int>(concurrencyLimit)) {
+            stateChanged.wait(lock);
+            continue;
+        }
+
+        refill(now);
+        if (tokens >= 1) {
+            tokens -= 1;
+            inFlight++;
+            return now;
+        }
+
+        //wait until the next token is earned
+        auto untilNextToken = chrono::duration<double>((1 - tokens) / ratePerSecond);
+        stateChanged.wait_until(lock, now + chrono::duration_cast<clock::duration>(untilNextToken));
+    }
+}
+
+bool rateLimiter::tryAcquire(clock::time_point& started, clock::duration& wait) {
+    lock_guard<mutex> lock(limiterMutex);
+    clock::time_point now = clock::now();
+
+    if (now < pausedUntil) {
+        wait = pausedUntil - now;
+        return false;
+    }
+
+    //nothing notifies a coroutine when a request finishes, so it checks again shortly
+    if (inFlight >= static_cast<int>(concurrencyLimit)) {
+        wait = chrono::milliseconds(5);
+        return false;
+    }
+
+    refill(now);
+    if (tokens >= 1) {
+        tokens -= 1;
+        inFlight++;
+        started = now;
+        return true;
+    }
+
+    wait = chrono::duration_cast<clock::duration>(chrono::duration<double>((1 - tokens) / ratePerSecond));
+    return false;
+}
+
+void rateLimiter::release(clock::time_point started, long status, double retryAfterSeconds) {
+    {
+        lock_guard<mutex> lock(limiterMutex);
+        inFlight--;
+
+        clock::time_point now = clock::now();
+        bool overloaded = status == 429 || status == 503;
+
+        if (overloaded) {
+            //multiplicative decrease, once per burst of errors (requests already in flight when the limit was
+            //halved were sent under the old limit and would otherwise halve it again)
+            if (started >= lastDecrease) {
+                concurrencyLimit = max(1.0, concurrencyLimit / 2);
+                lastDecrease = now;
+            }
+            if (retryAfterSeconds > 0) {
+                pausedUntil = max(pausedUntil, now + chrono::duration_cast<clock::duration>(chrono::duration<double>(retryAfterSeconds)));
+                tokens = 0;
+            }
+        } else if (status >= 200 && status < 500) {
+            //additive increase: about +1 after a full window of successful requests
+            concurrencyLimit = min(static_cast<double>(maxConcurrency), concurrencyLimit + 1 / concurrencyLimit);
+        }
+    }
+    stateChanged.notify_all();
+}
+
+void rateLimiter::setRate(double requestsPerSecond, int burstSize) {
+    {
+        lock_guard<mutex> lock(limiterMutex);
+        refill(clock::now());
+        ratePerSecond = max(0.1, requestsPerSecond);
+        burst = max(1, burstSize);
+        tokens = min(tokens, burst);
+    }
+    stateChanged.notify_all();
+}
+
+void rateLimiter::setMaxConcurrency(int limit) {
+    {
+        lock_guard<mutex> lock(limiterMutex);
+        maxConcurrency = max(1, limit);
+        concurrencyLimit = min(concurrencyLimit, static_cast<double>(maxConcurrency));
+    }
+    stateChanged.notify_all();
+}
+
+int rateLimiter::currentConcurrency() const {
+    lock_guard<mutex> lock(limiterMutex);
+    return static_cast<int>(concurrencyLimit);
+}
+
+double parseRetryAfter(const string& value, double fallback) {
+    if (value.empty()) {
+        return fallback;
+    }
+
+    //delay in seconds, e.g. "Retry-After: 2"
+    if (all_of(value.begin(), value.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+        return stod(value);
+    }
+
+    //http date, e.g. "Retry-After: Wed, 21 Oct 2015 07:28:00 GMT"
+    tm date = {};
+    istringstream stream(value);
+    stream >> get_time(&date, "%a, %d %b %Y %H:%M:%S");
+    if (stream.fail()) {
+        return fallback;
+    }
+    double seconds = difftime(timegm(&date), time(nullptr));
+    return max(0.0, seconds);
+}
@@ -0,0 +1,65 @@
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+
+using namespace std;
+
+//keeps requests under what the api tolerates
+// - token bucket: at most ratePerSecond requests per second on average, with bursts of up to burst requests
+// - adaptive concurrency (AIMD): the number of requests in flight grows by about one per round of successful
+//   requests and is halved when the server answers 429 (too many requests) or 503
+// - when the server sends Retry-After, no new request starts until that time has passed
+class rateLimiter {
+public:
+    using clock = chrono::steady_clock;
+
+private:
+    mutable mutex limiterMutex;
+    condition_variable stateChanged;
+
+    double ratePerSecond;
+    double burst;
+    double tokens;
+    clock::time_point lastRefill;
+
+    double concurrencyLimit; //current limit (fractional, so it can grow by less than one request at a time)
+    int maxConcurrency;
+    int inFlight;
+
+    clock::time_point pausedUntil; //set from Retry-After
+    clock::time_point lastDecrease; //requests sent before this don't halve the limit again
+
+    //adds the tokens earned since the last refill (assumes limiterMutex is held)
+    void refill(clock::time_point now);
+
+public:
+    rateLimiter(double ratePerSecond = 40, int burst = 40, int initialConcurrency = 4, int maxConcurrency = 32); //constructor
+
+    //blocks until a request may be sent and returns the time it was allowed to start
+    clock::time_point acquire();
+
+    //non-blocking acquire for the event loop: returns true and sets started if a request may be sent now,
+    //otherwise returns false and sets wait to how long to wait before trying again
+    bool tryAcquire(clock::time_point& started, clock::duration& wait);
+
+    //reports how a request that got through acquire ended (status 0 if the transfer failed)
+    //retryAfterSeconds is how long the server asked us to wait (0 if it didn't)
+    void release(clock::time_point started, long status, double retryAfterSeconds);
+
+    void setRate(double requestsPerSecond, int burstSize);
+    void setMaxConcurrency(int limit);
+
+    //current number of requests allowed in flight
+    int currentConcurrency() const;
+};
+
+//parses a Retry-After header value (either seconds or an http date) into seconds from now
+//returns fallback if the value is empty or can't be read
+double parseRetryAfter(const string& value, double fallback);
+
+#endif //LIMITER_H
@@ -1,5 +1,7 @@
 #include <iostream>
+#include <climits>
 #include "graph.h"
+#include "importer.h"
 //Group 95 - Project by Giovana, Lutfiyah, and Joshua
 //function to display the path
 void displayPath(const SearchResult& result, const string& algorithm, ostream& out = cout) {
@@ -11,6 +13,11 @@ void displayPath(const SearchResult& result, const string& algorithm, ostream& o
     out << "\n============== " << algorithm << " Path ==============" << endl;
     out << "Algorithm time: " << fixed << setprecision(2) << result.algorithm_ms << " ms" << endl;
     out << "Nodes visited: " << result.visited << endl;
+    out << "Edges scanned: " << result.edges;
+    if (result.algorithm_ms > 0) {
+        out << " (" << fixed << setprecision(2) << result.edges / result.algorithm_ms / 1000.0 << " million edges/s)";
+    }
+    out << endl;
 
     // prints path with movie connection
     out << "\nPath: ";
@@ -82,6 +89,48 @@ void displayPerformances(const SearchResult& bds, const SearchResult& bfs, ostre
     }
 }
 
+//shows how many requests went over the network (cold) and how many came from the disk cache (warm)
+void displayFetchStats(const apiStats& stats, ostream& out = cout) {
+    out << "\n===== Data Fetching =====" << endl;
+    out << "Network (cold): " << stats.networkRequests << " requests, "
+        << fixed << setprecision(2) << stats.networkMs << " ms" << endl;
+    out << "Disk cache (warm): " << stats.diskHits << " hits, "
+        << fixed << setprecision(2) << stats.diskMs << " ms, "
+        << stats.revalidated << " expired entries revalidated (304)" << endl;
+    out << "Memory cache: " << stats.memoryHits << " hits, " << stats.memoryMisses << " misses, "
+        << stats.coalesced << " coalesced with a request in flight" << endl;
+    out << "Known missing: " << stats.knownMissing << " lookups skipped" << endl;
+    out << "Cast policy: " << stats.castDropped << " cast entries left out" << endl;
+    out << "Rate limiting: " << stats.throttled << " throttled (429), " << stats.retries << " retries, "
+        << stats.concurrency << " requests in flight allowed" << endl;
+    out << "Hedging: " << stats.hedged << " duplicate requests sent, " << stats.hedgeWins << " answered first" << endl;
+    out << "Bytes: " << stats.wireBytes << " over the wire (" << stats.decodedBytes << " decoded), "
+        << stats.diskBytesRead << " read from disk, " << stats.diskBytesWritten << " written to disk" << endl;
+}
+
+//builds the graph from the bulk files instead of the api, returns false if one of them can't be read
+bool importGraph(Graph& graph, const char* creditsPath, const char* peoplePath, const char* moviesPath,
+                 const castPolicy& policy, ostream& out = cout) {
+    bulkImporter importer(graph, 0, policy);
+    bool ok = importer.importCredits(creditsPath);
+    if(ok && peoplePath != nullptr) {
+        ok = importer.importPeople(peoplePath);
+    }
+    if(ok && moviesPath != nullptr) {
+        ok = importer.importMovies(moviesPath);
+    }
+    if(!ok) {
+        cerr << "ERROR: Import failed: " << importer.lastError() << endl;
+        return false;
+    }
+
+    importStats stats = importer.getStats();
+    out << "Imported " << stats.movies << " movies from " << stats.lines << " lines in "
+        << fixed << setprecision(2) << stats.ms << " ms (" << stats.badLines << " bad lines skipped, "
+        << stats.castDropped << " cast entries left out, " << stats.namesFilled << " names filled in)" << endl;
+    return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main(){
@@ -89,40 +138,149 @@ int main(){
     cout << "============== Welcome to StarPath! ==============\n" << endl;
 
     //initializing objects
-    api tmdb("07663db07b6982f498aef71b6b0997f7");
+    //TMDB_BASE_URL can point the program at a local stand-in server (for offline runs)
+    const char* baseUrl = getenv("TMDB_BASE_URL");
+    api tmdb("07663db07b6982f498aef71b6b0997f7", baseUrl != nullptr ? baseUrl : "https://api.themoviedb.org/3");
+
+    //STARPATH_RECORD_DIR saves every request to a fixture directory, STARPATH_REPLAY_DIR answers every request
+    //from one (with STARPATH_REPLAY_LATENCY_MS added to each) -> deterministic runs with no network
+    const char* recordDir = getenv("STARPATH_RECORD_DIR");
+    const char* replayDir = getenv("STARPATH_REPLAY_DIR");
+    const char* replayLatency = getenv("STARPATH_REPLAY_LATENCY_MS");
+    if(replayDir != nullptr) {
+        tmdb.replayFrom(replayDir, replayLatency != nullptr ? atoi(replayLatency) : 0);
+    } else if(recordDir != nullptr) {
+        tmdb.recordTo(recordDir);
+    } else {
+        //responses are kept between runs (STARPATH_CACHE_DIR can move the cache somewhere else)
+        //not used while recording or replaying, so every request ends up in (or comes from) the fixtures
+        const char* cacheDir = getenv("STARPATH_CACHE_DIR");
+        tmdb.enableDiskCache(cacheDir != nullptr ? cacheDir : "starpath_cache");
+    }
+
+    //STARPATH_HEDGE_BUDGET (e.g. 0.05) duplicates requests slower than the usual p95, for at most that fraction of them
+    const char* hedgeBudget = getenv("STARPATH_HEDGE_BUDGET");
+    if(hedgeBudget != nullptr && atof(hedgeBudget) > 0) {
+        tmdb.enableHedging(atof(hedgeBudget));
+    }
+    //STARPATH_CAST_DEPTH keeps only the top billed cast of each movie (e.g. 15 -> billing positions 0-14),
+    //STARPATH_SKIP_MINOR_ROLES=1 also leaves out uncredited and voice roles
+    const char* castDepth = getenv("STARPATH_CAST_DEPTH");
+    const char* skipMinorRoles = getenv("STARPATH_SKIP_MINOR_ROLES");
+    bool skipMinor = skipMinorRoles != nullptr && string(skipMinorRoles) != "0";
+    int depth = -1;
+    if(castDepth != nullptr) {
+        char* end = nullptr;
+        long parsed = strtol(castDepth, &end, 10);
+        if(end == castDepth || *end != '\0' || parsed < 1 || parsed > INT_MAX) {
+            cerr << "ERROR: STARPATH_CAST_DEPTH must be a positive number of cast entries, got '" << castDepth << "'" << endl;
+            return 1;
+        }
+        depth = static_cast<int>(parsed);
+    }
+    castPolicy policy(depth, skipMinor, skipMinor);
+    if(castDepth != nullptr || skipMinor) {
+        tmdb.setCastPolicy(policy);
+    }
+
+    //STARPATH_IMPORT_CREDITS builds the whole graph offline from a credits dump (see importer.h) instead of
+    //expanding it through the api, STARPATH_IMPORT_PEOPLE / STARPATH_IMPORT_MOVIES are TMDB id exports that
+    //fill in names and titles the dump is missing
+    const char* importCredits = getenv("STARPATH_IMPORT_CREDITS");
     string actorName1, actorName2;
 
     //getting user input
     cout << "Enter name of the first actor: " << endl;
     getline(cin, actorName1);
-    int actorId1 = tmdb.searchActor(actorName1);
-    auto actor1 = tmdb.getActor(actorId1);
-    if(actor1 == NULL || actor1->name != actorName1) {
-        cerr << "No actors named '" << actorName1 << "' were found. Exiting program..." << endl;
-        return 1;
-    }
 
     cout << "Enter name of the second actor: " << endl;
     getline(cin, actorName2);
 
-    int actorId2 = tmdb.searchActor(actorName2);
-    auto actor2 = tmdb.getActor(actorId2);
-    if(actor2 == NULL || actor2->name != actorName2) {
-        cerr << "No actors named '" << actorName2 << "' were found. Exiting program..." << endl;
-        return 1;
-    }
+    //STARPATH_ASYNC runs the requests as coroutines on an event loop instead of on threads
+    const char* asyncMode = getenv("STARPATH_ASYNC");
+    bool useAsync = asyncMode != nullptr && string(asyncMode) != "0";
 
-    //build graph
-    cout << "--------------------------------------------------" << endl;
-
-    cout << "Creating constellation...\n" << endl;
+    //STARPATH_BIPARTITE keeps movies as vertices linked to their cast instead of connecting every two co-stars
+    //(see Graph::setBipartite), for dumps whose big casts would blow up the number of connections
+    const char* bipartiteMode = getenv("STARPATH_BIPARTITE");
 
     Graph graph(tmdb);
-    graph.addActor(actor1, actorId2);
-    graph.addActor(actor2, actorId1);
+    graph.setAsyncFetching(useAsync);
+    graph.setBipartite(bipartiteMode != nullptr && string(bipartiteMode) != "0");
+    int actorId1 = 0;
+    int actorId2 = 0;
+
+    if(importCredits != nullptr) {
+        cout << "--------------------------------------------------" << endl;
+        cout << "Importing constellation...\n" << endl;
+
+        if(!importGraph(graph, importCredits, getenv("STARPATH_IMPORT_PEOPLE"), getenv("STARPATH_IMPORT_MOVIES"), policy)) {
+            return 1;
+        }
+        graph.setExpandOnDemand(false); //everything there is to know is in the graph already
+
+        Actor* actor1 = graph.findActorByName(actorName1);
+        Actor* actor2 = graph.findActorByName(actorName2);
+        if(actor1 == nullptr) {
+            cerr << "No actors named '" << actorName1 << "' were found. Exiting program..." << endl;
+            return 1;
+        }
+        if(actor2 == nullptr) {
+            cerr << "No actors named '" << actorName2 << "' were found. Exiting program..." << endl;
+            return 1;
+        }
+        actorId1 = actor1->id;
+        actorId2 = actor2->id;
+    } else {
+        //both names are resolved at the same time, each with a single request
+        Actor* actor1 = nullptr;
+        Actor* actor2 = nullptr;
+        if(useAsync) {
+            eventLoop loop(tmdb.client());
+            vector<task<void>> lookups;
+            auto resolve = [&](const string& name, Actor*& out) -> task<void> {
+                out = co_await tmdb.resolveActorAsync(loop, name);
+            };
+            lookups.push_back(resolve(actorName1, actor1));
+            lookups.push_back(resolve(actorName2, actor2));
+            loop.runAll(lookups);
+        } else {
+            auto resolveFirst = async(launch::async, [&]() { return tmdb.resolveActor(actorName1); });
+            actor2 = tmdb.resolveActor(actorName2);
+            actor1 = resolveFirst.get();
+        }
+
+        if(actor1 == NULL || actor1->name != actorName1) {
+            cerr << "No actors named '" << actorName1 << "' were found. Exiting program..." << endl;
+            delete actor1;
+            delete actor2;
+            return 1;
+        }
+        if(actor2 == NULL || actor2->name != actorName2) {
+            cerr << "No actors named '" << actorName2 << "' were found. Exiting program..." << endl;
+            delete actor1;
+            delete actor2;
+            return 1;
+        }
+
+        actorId1 = actor1->id;
+        actorId2 = actor2->id;
+
+        //build graph
+        cout << "--------------------------------------------------" << endl;
+
+        cout << "Creating constellation...\n" << endl;
+
+        graph.addActor(actor1, actorId2);
+        graph.addActor(actor2, actorId1);
+    }
 
     auto stats = graph.getStats();
-    cout << "Graph build with " << stats.first << " actors and " << stats.second << " connections." << endl;
+    cout << "Graph build with " << stats.first << " actors and " << stats.second
+         << (graph.isBipartite() ? " actor-movie links." : " connections.") << endl;
+    graphAllocStats allocStats = graph.getAllocStats();
+    cout << "Records: " << allocStats.actors << " actors and " << allocStats.movies << " movies in "
+         << allocStats.slabs << " slab allocations." << endl;
 
     //perform searches
     cout << "--------------------------------------------------" << endl;
@@ -148,6 +306,10 @@ int main(){
 
     displayPerformances(bidirectional, breadthfirst, outputFile);
 
+    apiStats fetchStats = tmdb.getStats();
+    displayFetchStats(fetchStats);
+    displayFetchStats(fetchStats, outputFile);
+
     //close file
     if(outputFile.is_open()) {
         outputFile.close();
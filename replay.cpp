@@ -0,0 +1,75 @@
+#include "replay.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+
+#include "cache.h"
+#include "json.hpp"
+using json = nlohmann::json;
+
+fixtureStore::fixtureStore(const string& directory, int latencyMs)
+    : directory(directory), latencyMs(latencyMs), tempCounter(0) {
+    error_code ec;
+    filesystem::create_directories(this->directory, ec);
+}
+
+void fixtureStore::record(const string& key, const httpResponse& response, double elapsedMs) {
+    if (!response.error.empty()) {
+        return; //nothing came back -> nothing to replay
+    }
+
+    //first line is a header with the request and status, the rest is the body exactly as received
+    json header;
+    header["key"] = key;
+    header["status"] = response.status;
+    header["elapsed_ms"] = elapsedMs;
+
+    filesystem::path path = directory / diskCache::fileNameFor(key);
+    stringstream tempName;
+    tempName << path.filename().string() << "." << this_thread::get_id() << "." << tempCounter++ << ".tmp";
+    filesystem::path tempPath = directory / tempName.str();
+    {
+        ofstream file(tempPath, ios::binary | ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        file << header.dump() << "\n" << response.body;
+    }
+
+    error_code ec;
+    filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        filesystem::remove(tempPath, ec);
+    }
+}
+
+httpResponse fixtureStore::replay(const string& key) {
+    if (latencyMs > 0) {
+        this_thread::sleep_for(chrono::milliseconds(latencyMs));
+    }
+    return load(key);
+}
+
+httpResponse fixtureStore::load(const string& key) {
+    httpResponse response;
+
+    ifstream file(directory / diskCache::fileNameFor(key), ios::binary);
+    string headerLine;
+    if (!file.is_open() || !getline(file, headerLine)) {
+        response.error = "no fixture recorded for " + key;
+        return response;
+    }
+
+    json header = json::parse(headerLine, nullptr, false);
+    if (header.is_discarded() || header.value("key", "") != key) {
+        response.error = "no fixture recorded for " + key;
+        return response;
+    }
+
+    response.status = header.value("status", 0L);
+    response.body.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    response.wireBytes = response.body.size();
+    return response;
+}
@@ -0,0 +1,38 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <string>
+#include <atomic>
+#include <filesystem>
+#include "http.h"
+
+using namespace std;
+
+//record/replay of api traffic, so runs can be repeated without the network
+// - in record mode every request and its response are saved in a fixture directory
+// - in replay mode requests are answered from those fixtures in-process (after an injected latency),
+//   so BFS/BDS timings can be benchmarked deterministically and offline
+//fixtures use the same normalized keys as the disk cache (no api key), one file per request
+class fixtureStore {
+private:
+    filesystem::path directory;
+    int latencyMs; //delay added to every replayed request
+    atomic<unsigned> tempCounter; //makes temporary file names unique between threads
+
+public:
+    fixtureStore(const string& directory, int latencyMs = 0); //constructor
+
+    //saves the response to a request (elapsedMs is how long the real request took)
+    void record(const string& key, const httpResponse& response, double elapsedMs);
+
+    //answers a request from its fixture, waiting latencyMs first
+    //if there is no fixture for the key, the response has status 0 and an error message
+    httpResponse replay(const string& key);
+
+    //same as replay, without the latency (the event loop waits for it without blocking)
+    httpResponse load(const string& key);
+
+    int latency() const { return latencyMs; }
+};
+
+#endif //REPLAY_H
@@ -0,0 +1,150 @@
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <vector>
+#include "async.h"
+
+using namespace std;
+
+//coalesces duplicate work that is in flight at the same time
+//the first caller for a key runs fetch, callers asking for the same key while it runs wait on the same
+//future and get the same result (so co-stars expanded in parallel don't request the same movie twice)
+template <typename K, typename V>
+class singleFlight {
+private:
+    mutex flightMutex;
+    unordered_map<K, shared_future<V>> inFlight; //(key, result of the fetch that is running)
+    atomic<long long> coalesced; //callers that got another caller's result
+
+public:
+    singleFlight() : coalesced(0) {}
+
+    V run(const K& key, const function<V()>& fetch) {
+        promise<V> result;
+        shared_future<V> pending;
+        bool first = false;
+        {
+            lock_guard<mutex> lock(flightMutex);
+            auto it = inFlight.find(key);
+            if (it == inFlight.end()) {
+                pending = result.get_future().share();
+                inFlight[key] = pending;
+                first = true;
+            } else {
+                pending = it->second;
+            }
+        }
+
+        //someone else is already fetching this key -> wait for their result
+        if (!first) {
+            coalesced++;
+            return pending.get();
+        }
+
+        try {
+            V value = fetch();
+            result.set_value(value);
+            lock_guard<mutex> lock(flightMutex);
+            inFlight.erase(key);
+            return value;
+        } catch (...) {
+            result.set_exception(current_exception());
+            lock_guard<mutex> lock(flightMutex);
+            inFlight.erase(key);
+            throw;
+        }
+    }
+
+    long long coalescedCount() const { return coalesced; }
+};
+
+//the same for coroutines on an eventLoop: the first lookup for a key runs fetch, identical lookups started on the
+//same loop while it runs are suspended and resumed with its result -> one request, one limiter permit and one
+//cache write per key, however many coroutines asked for it
+//(flights are kept per loop, since a waiter can only be resumed by the loop it runs on)
+template <typename K, typename V>
+class asyncSingleFlight {
+private:
+    struct flight {
+        bool done;
+        V value;
+        exception_ptr error;
+        vector<coroutine_handle<>> waiters;
+
+        flight() : done(false) {}
+    };
+
+    //suspends a caller until the flight it joined is done
+    //(holds a plain reference: the caller's shared_ptr keeps the flight alive, and an owning copy inside a
+    //co_await temporary was released twice by gcc 12)
+    struct joinAwaiter {
+        flight& joined;
+
+        bool await_ready() const noexcept { return joined.done; }
+        void await_suspend(coroutine_handle<> awaiting) { joined.waiters.push_back(awaiting); }
+        void await_resume() const noexcept {}
+    };
+
+    mutex flightMutex;
+    map<pair<eventLoop*, K>, shared_ptr<flight>> inFlight; //((loop, key), fetch that is running on it)
+    atomic<long long> coalesced;
+
+public:
+    asyncSingleFlight() : coalesced(0) {}
+
+    //fetch is only started if no identical lookup is in flight on loop (tasks are lazy)
+    task<V> run(eventLoop& loop, K key, task<V> fetch) {
+        shared_ptr<flight> current;
+        bool first = false;
+        {
+            lock_guard<mutex> lock(flightMutex);
+            auto it = inFlight.find(make_pair(&loop, key));
+            if (it == inFlight.end()) {
+                current = make_shared<flight>();
+                inFlight[make_pair(&loop, key)] = current;
+                first = true;
+            } else {
+                current = it->second;
+            }
+        }
+
+        //someone else on this loop is already fetching this key -> wait for their result
+        if (!first) {
+            coalesced++;
+            co_await joinAwaiter{*current};
+            if (current->error) {
+                rethrow_exception(current->error);
+            }
+            co_return current->value;
+        }
+
+        try {
+            current->value = co_await fetch;
+        } catch (...) {
+            current->error = current_exception();
+        }
+        current->done = true;
+        {
+            lock_guard<mutex> lock(flightMutex);
+            inFlight.erase(make_pair(&loop, key));
+        }
+        for (coroutine_handle<> waiter : current->waiters) {
+            loop.wake(waiter);
+        }
+        if (current->error) {
+            rethrow_exception(current->error);
+        }
+        co_return current->value;
+    }
+
+    long long coalescedCount() const { return coalesced; }
+};
+
+#endif //SINGLEFLIGHT_H